@@ -0,0 +1,993 @@
+#include "synth.h"
+#include "synth_static.h"
+#include "synth_simd.h"
+#include "synth_patch.h"
+#include "synth_pack.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+#include "math.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES() __rdtsc()
+#else
+#define BENCH_CYCLES() 0
+#endif
+
+//benchmarks for each node type, the test.c patches, and scaling over voices and nodes.
+//results are printed, and written as csv to bench.csv (or the file given as the first argument).
+//build with -DSYNTH_PROFILE=1 for a per node type profile
+
+q15_t half = Q15_MAX / 2;
+SynthPhase_t lfoPhaseInc = SYNTH_HZ_TO_INCREMENT(5);
+q15_t vibratoInc = SYNTH_HZ_TO_PHASE(10);
+
+//the same voices test.c wires up by hand
+#define BRASS_PATCH(X) \
+    X(ENVELOPE, 1, NONE, 500, 150, Q15_MAX * .8, 150) \
+    X(OSCILLATOR, 2, EXT(&vibratoInc), EXT(&lfoPhaseInc), NONE, sineWave) \
+    X(OSCILLATOR, 3, NODE(1), EXT(&voice->phaseIncrement), NODE(2), sawtoothWave) \
+    X(FILTER_LP, 0, NONE, NODE(3), 8000)
+
+#define BASS_PATCH(X) \
+    X(ENVELOPE, 1, NONE, 100, 500, Q15_MAX * 0.5, 15) \
+    X(OSCILLATOR, 2, NODE(1), EXT(&voice->phaseIncrement), NONE, squareWave) \
+    X(FILTER_LP, 0, NONE, NODE(2), 4000)
+
+//brass with a band limited sawtooth, and no filter
+#define BRASS_BL_PATCH(X) \
+    X(ENVELOPE, 1, NONE, 500, 150, Q15_MAX * .8, 150) \
+    X(OSCILLATOR, 2, EXT(&vibratoInc), EXT(&lfoPhaseInc), NONE, sineWave) \
+    X(OSCILLATOR_BL, 0, NODE(1), EXT(&voice->phaseIncrement), NODE(2), sawtoothWaveBl)
+
+#define BASS_BL_PATCH(X) \
+    X(ENVELOPE, 1, NONE, 100, 500, Q15_MAX * 0.5, 15) \
+    X(OSCILLATOR_BL, 0, NODE(1), EXT(&voice->phaseIncrement), NONE, squareWaveBl)
+
+//an 8 frame bank going from a sine to a full sawtooth, doubling the harmonics each frame
+#define BENCH_BANK_BITS 8
+static q15_t benchBankSamples[8 << BENCH_BANK_BITS];
+static const SynthWavetable_t benchBank = SYNTH_WAVETABLE(benchBankSamples, BENCH_BANK_BITS);
+
+//brass as a single wavetable oscillator that gets brighter as the envelope opens, instead of a sawtooth and filter
+#define BRASS_WT_PATCH(X) \
+    X(ENVELOPE, 1, NONE, 500, 150, Q15_MAX * .8, 150) \
+    X(OSCILLATOR, 2, EXT(&vibratoInc), EXT(&lfoPhaseInc), NONE, sineWave) \
+    X(WAVETABLE, 0, NODE(1), EXT(&voice->phaseIncrement), NODE(2), &benchBank, NODE(1))
+
+#define BASS_WT_PATCH(X) \
+    X(ENVELOPE, 1, NONE, 100, 500, Q15_MAX * 0.5, 15) \
+    X(WAVETABLE, 0, NODE(1), EXT(&voice->phaseIncrement), NONE, &benchBank, EXT(&half))
+
+//the test patch through resonant state variable filters, the brass one swept by the envelope.
+//the bass mixes the low pass and band pass responses of the one filter
+q15_t svfCutoff = SYNTH_SVF_CUTOFF(800);
+q15_t svfResonance = Q15_MAX * .7;
+
+#define BRASS_SVF_PATCH(X) \
+    X(ENVELOPE, 1, NONE, 500, 150, Q15_MAX * .8, 150) \
+    X(OSCILLATOR, 2, EXT(&vibratoInc), EXT(&lfoPhaseInc), NONE, sineWave) \
+    X(OSCILLATOR, 3, NODE(1), EXT(&voice->phaseIncrement), NODE(2), sawtoothWave) \
+    X(FILTER_SVF, 0, NONE, NODE(3), NODE(1), EXT(&svfResonance), SYNTH_SVF_LP)
+
+#define BASS_SVF_PATCH(X) \
+    X(ENVELOPE, 1, NONE, 100, 500, Q15_MAX * 0.5, 15) \
+    X(OSCILLATOR, 2, NODE(1), EXT(&voice->phaseIncrement), NONE, squareWave) \
+    X(FILTER_SVF, 3, NONE, NODE(2), EXT(&svfCutoff), EXT(&svfResonance), SYNTH_SVF_LP) \
+    X(MIXER, 0, NONE, NODE(3), TAP(3, SYNTH_SVF_BP), NONE)
+
+//brass with a breath of noise on the envelope
+#define BRASS_NOISE_PATCH(X) \
+    X(ENVELOPE, 1, NONE, 500, 150, Q15_MAX * .8, 150) \
+    X(OSCILLATOR, 2, EXT(&vibratoInc), EXT(&lfoPhaseInc), NONE, sineWave) \
+    X(OSCILLATOR, 3, NODE(1), EXT(&voice->phaseIncrement), NODE(2), sawtoothWave) \
+    X(NOISE, 4, NODE(1), 1) \
+    X(MIXER, 0, EXT(&half), NODE(3), NODE(4), NONE)
+
+//a plucked string at a fixed 220 Hz, a burst of noise into a delay feeding back on itself, with the delay's
+//interpolation as the damping. the bass gets an echo an eighth of a second later
+#define BENCH_DELAY_LENGTH 8192
+q15_t pluckTime = SYNTH_DELAY_TIME(SAMPLE_RATE / 220.0, BENCH_DELAY_LENGTH);
+q15_t pluckFeedback = Q15_MAX * .99;
+q15_t echoTime = SYNTH_DELAY_TIME(SAMPLE_RATE / 8, BENCH_DELAY_LENGTH);
+q15_t echoFeedback = Q15_MAX * .4;
+
+#define PLUCK_PATCH(X) \
+    X(ENVELOPE, 2, NONE, 20000, 8000, 0, 8000) \
+    X(NOISE, 1, NODE(2), 1) \
+    X(DELAY, 0, NONE, NODE(1), EXT(&pluckTime), EXT(&pluckFeedback))
+
+#define BASS_ECHO_PATCH(X) \
+    X(ENVELOPE, 1, NONE, 100, 500, Q15_MAX * 0.5, 15) \
+    X(OSCILLATOR, 2, NODE(1), EXT(&voice->phaseIncrement), NONE, squareWave) \
+    X(FILTER_LP, 3, NONE, NODE(2), 4000) \
+    X(DELAY, 4, NONE, NODE(3), EXT(&echoTime), EXT(&echoFeedback)) \
+    X(MIXER, 0, EXT(&half), NODE(3), NODE(4), NONE)
+
+SYNTH_STATIC_VOICE(brass, BRASS_PATCH)
+SYNTH_STATIC_VOICE(bass, BASS_PATCH)
+SYNTH_STATIC_VOICE(brassBl, BRASS_BL_PATCH)
+SYNTH_STATIC_VOICE(bassBl, BASS_BL_PATCH)
+SYNTH_STATIC_VOICE(brassWt, BRASS_WT_PATCH)
+SYNTH_STATIC_VOICE(bassWt, BASS_WT_PATCH)
+SYNTH_STATIC_VOICE(brassSvf, BRASS_SVF_PATCH)
+SYNTH_STATIC_VOICE(bassSvf, BASS_SVF_PATCH)
+SYNTH_STATIC_VOICE(brassNoise, BRASS_NOISE_PATCH)
+SYNTH_STATIC_VOICE(pluck, PLUCK_PATCH)
+SYNTH_STATIC_VOICE(bassEcho, BASS_ECHO_PATCH)
+
+#define BENCH_NOTES 32
+#define BENCH_NOTE_SAMPLES (SAMPLE_RATE / 4)
+#define BENCH_SAMPLES (BENCH_NOTES * BENCH_NOTE_SAMPLES)
+#define BENCH_RUNS 3
+//the voice scaling goes up to this many
+#ifndef BENCH_VOICES
+#define BENCH_VOICES 16
+#endif
+
+//each case gets a fresh instance with as many voices as it plays, all with room for SYNTH_NODES nodes,
+//and room for the delay lines, decimators and voice packs of the cases that have them
+static uint8_t benchArena[SYNTH_ARENA_SIZE(BENCH_VOICES, BENCH_VOICES * SYNTH_NODES) + SYNTH_DELAY_POOL_SIZE(2, BENCH_DELAY_LENGTH)
+        + 2 * SYNTH_OVERSAMPLE_SIZE + BENCH_VOICES * SYNTH_PACK_SIZE(1, SYNTH_NODES)];
+static Synth_t benchSynth;
+
+static void benchReset(int voiceCount) {
+    synthInit(&benchSynth, benchArena, sizeof(benchArena), voiceCount);
+    for (int v = 0; v < voiceCount; v++) {
+        synthVoiceAlloc(&benchSynth, v, SYNTH_NODES);
+    }
+}
+
+enum {
+    BENCH_PER_SAMPLE,
+    BENCH_BLOCK,
+    BENCH_STATIC,
+    BENCH_PACK, //synthPackRender, one pack for all the voices if they share a patch, otherwise one each
+    BENCH_STEREO, //synthProcessBlockStereo, keeping bus 0 left. panned, so it isn't compared with synthProcess
+};
+static const char *benchModeNames[] = {"synthProcess", "synthProcessBlock", "compiled patch", "voice pack", "stereo"};
+
+static FILE *benchCsv;
+static q15_t *benchReference;
+static q15_t *benchOut;
+static int benchFailed;
+//renders the compiled versions of the patch being measured
+static void (*benchStaticRender)(int32_t *mix, int n);
+static SynthPack_t benchPacks[BENCH_VOICES];
+static int benchPackCount;
+static uint8_t benchPackOf[BENCH_VOICES]; //pack each voice plays in, and which of its voices
+static uint8_t benchPackVoice[BENCH_VOICES];
+
+//voices play in one pack when they save as the same patch, otherwise in a pack each
+static int benchSetupPacks() {
+    uint8_t first[SYNTH_PATCH_MAX_SIZE], patch[SYNTH_PATCH_MAX_SIZE];
+    int voiceCount = benchSynth.voiceCount;
+    int size = synthPatchSave(&benchSynth.voices[0], first, sizeof(first), NULL, 0);
+    int shared = size > 0;
+    for (int v = 1; v < voiceCount && shared; v++) {
+        shared = synthPatchSave(&benchSynth.voices[v], patch, sizeof(patch), NULL, 0) == size && !memcmp(first, patch, size);
+    }
+    benchPackCount = shared ? 1 : voiceCount;
+    for (int v = 0; v < voiceCount; v++) {
+        benchPackOf[v] = shared ? 0 : v;
+        benchPackVoice[v] = shared ? v : 0;
+    }
+    for (int k = 0; k < benchPackCount; k++) {
+        if (synthPackInit(&benchPacks[k], &benchSynth, &benchSynth.voices[k], shared ? voiceCount : 1)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void benchNoteOn(int mode, int v, uint8_t note) {
+    if (mode == BENCH_PACK) {
+        synthPackNoteOn(&benchPacks[benchPackOf[v]], benchPackVoice[v], note);
+    } else {
+        synthVoiceNoteOn(&benchSynth.voices[v], note);
+    }
+}
+
+static void benchNoteOff(int mode, int v) {
+    if (mode == BENCH_PACK) {
+        synthPackNoteOff(&benchPacks[benchPackOf[v]], benchPackVoice[v]);
+    } else {
+        synthVoiceNoteOff(&benchSynth.voices[v]);
+    }
+}
+
+static void benchRender(int mode, q15_t *out, int n) {
+    if (mode == BENCH_PER_SAMPLE) {
+        for (int i = 0; i < n; i++) {
+            out[i] = synthProcess(&benchSynth);
+        }
+    } else if (mode == BENCH_BLOCK) {
+        synthProcessBlock(&benchSynth, out, n);
+    } else if (mode == BENCH_STEREO) {
+        q15_t frames[SYNTH_BLOCK_SIZE * SYNTH_BUSES * 2];
+        while (n > 0) {
+            int count = n < SYNTH_BLOCK_SIZE ? n : SYNTH_BLOCK_SIZE;
+            synthProcessBlockStereo(&benchSynth, frames, count);
+            for (int t = 0; t < count; t++) {
+                out[t] = frames[t * SYNTH_BUSES * 2];
+            }
+            out += count;
+            n -= count;
+        }
+    } else {
+        int32_t mix[SYNTH_BLOCK_SIZE];
+        while (n > 0) {
+            int count = n < SYNTH_BLOCK_SIZE ? n : SYNTH_BLOCK_SIZE;
+            memset(mix, 0, sizeof(mix));
+            if (mode == BENCH_PACK) {
+                for (int k = 0; k < benchPackCount; k++) {
+                    synthPackRender(&benchPacks[k], mix, count);
+                }
+            } else {
+                benchStaticRender(mix, count);
+            }
+            synthMixdown(&benchSynth, mix, out, count);
+            out += count;
+            n -= count;
+        }
+    }
+}
+
+//plays an arpeggio on the first voiceCount voices, note on for 3/4 of each note then note off
+static void benchPlay(int mode, q15_t *out, int voiceCount) {
+    for (int i = 0; i < BENCH_NOTES; i++) {
+        for (int v = 0; v < voiceCount; v++) {
+            benchNoteOn(mode, v, 36 + (i * 7 + v * 5) % 48);
+        }
+        benchRender(mode, out, BENCH_NOTE_SAMPLES * 3 / 4);
+        out += BENCH_NOTE_SAMPLES * 3 / 4;
+        for (int v = 0; v < voiceCount; v++) {
+            benchNoteOff(mode, v);
+        }
+        benchRender(mode, out, BENCH_NOTE_SAMPLES - BENCH_NOTE_SAMPLES * 3 / 4);
+        out += BENCH_NOTE_SAMPLES - BENCH_NOTE_SAMPLES * 3 / 4;
+    }
+}
+
+static void benchReport(const char *name, int mode, double ns, double cycles) {
+    printf("  %-24s %-18s %10.2f %12.0f %14.1f\n", name, benchModeNames[mode], ns, 1e9 / ns, cycles);
+    if (benchCsv) {
+        fprintf(benchCsv, "%s,%s,%.3f,%.0f,%.2f\n", name, benchModeNames[mode], ns, 1e9 / ns, cycles);
+    }
+}
+
+//time one case with a renderer, taking the best of a few runs to skip past noise.
+//the synthProcess output is kept as the reference the other renderers have to match
+static void benchMeasure(const char *name, void (*setup)(), int voiceCount, int mode) {
+    double bestNs = 1e30, bestCycles = 1e30;
+    q15_t *out = mode == BENCH_PER_SAMPLE ? benchReference : benchOut;
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        benchReset(voiceCount);
+        setup();
+        if (mode == BENCH_PACK && !benchSetupPacks()) {
+            printf("  %s: can't run as a voice pack\n", name);
+            benchFailed = 1;
+            return;
+        }
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        uint64_t startCycles = BENCH_CYCLES();
+        benchPlay(mode, out, voiceCount);
+        uint64_t endCycles = BENCH_CYCLES();
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / BENCH_SAMPLES;
+        double cycles = (double) (endCycles - startCycles) / BENCH_SAMPLES;
+        bestNs = ns < bestNs ? ns : bestNs;
+        bestCycles = cycles < bestCycles ? cycles : bestCycles;
+    }
+    benchReport(name, mode, bestNs, bestCycles);
+    if (mode != BENCH_PER_SAMPLE && mode != BENCH_STEREO && memcmp(benchReference, benchOut, BENCH_SAMPLES * sizeof(q15_t))) {
+        printf("  %s: %s output doesn't match synthProcess\n", name, benchModeNames[mode]);
+        benchFailed = 1;
+    }
+}
+
+static void benchRenderTestPatch(int32_t *mix, int n) {
+    brassRender(&benchSynth.voices[0], mix, n);
+    bassRender(&benchSynth.voices[1], mix, n);
+}
+
+static void benchSetupTestPatch() {
+    brassInit(&benchSynth.voices[0]);
+    bassInit(&benchSynth.voices[1]);
+    benchStaticRender = benchRenderTestPatch;
+}
+
+static void benchRenderBlPatch(int32_t *mix, int n) {
+    brassBlRender(&benchSynth.voices[0], mix, n);
+    bassBlRender(&benchSynth.voices[1], mix, n);
+}
+
+//the test patch with its envelopes and vibrato LFO at a control rate of SAMPLE_RATE / 16
+static void benchSetupControlRatePatch() {
+    benchSetupTestPatch();
+    synthNodeSetRate(&benchSynth.voices[0].nodes[1], 4);
+    synthNodeSetRate(&benchSynth.voices[0].nodes[2], 4);
+    synthNodeSetRate(&benchSynth.voices[1].nodes[1], 4);
+}
+
+//the test patch with the voices panned apart
+static void benchSetupStereoPatch() {
+    benchSetupTestPatch();
+    benchSynth.voices[0].pan = -Q15_MAX / 2;
+    benchSynth.voices[1].pan = Q15_MAX / 2;
+}
+
+static void benchSetupBlPatch() {
+    brassBlInit(&benchSynth.voices[0]);
+    bassBlInit(&benchSynth.voices[1]);
+    benchStaticRender = benchRenderBlPatch;
+}
+
+static void benchRenderWtPatch(int32_t *mix, int n) {
+    brassWtRender(&benchSynth.voices[0], mix, n);
+    bassWtRender(&benchSynth.voices[1], mix, n);
+}
+
+static void benchSetupWtPatch() {
+    brassWtInit(&benchSynth.voices[0]);
+    bassWtInit(&benchSynth.voices[1]);
+    benchStaticRender = benchRenderWtPatch;
+}
+
+static void benchRenderSvfPatch(int32_t *mix, int n) {
+    brassSvfRender(&benchSynth.voices[0], mix, n);
+    bassSvfRender(&benchSynth.voices[1], mix, n);
+}
+
+static void benchSetupSvfPatch() {
+    brassSvfInit(&benchSynth.voices[0]);
+    bassSvfInit(&benchSynth.voices[1]);
+    benchStaticRender = benchRenderSvfPatch;
+}
+
+//the svf test patch written out as patch data by benchCheckPatches
+static uint8_t benchPatches[2][SYNTH_PATCH_MAX_SIZE];
+static int benchPatchSizes[2];
+
+//load the voices from patch data instead of wiring them up
+static void benchSetupLoadedPatch() {
+    synthInit(&benchSynth, benchArena, sizeof(benchArena), 2);
+    for (int v = 0; v < 2; v++) {
+        synthPatchLoad(&benchSynth, v, benchPatches[v], benchPatchSizes[v], NULL, 0);
+    }
+}
+
+//write the svf test patch out, and time loading it back into voices like a program change would
+static int benchCheckPatches() {
+    benchReset(2);
+    benchSetupSvfPatch();
+    for (int v = 0; v < 2; v++) {
+        benchPatchSizes[v] = synthPatchSave(&benchSynth.voices[v], benchPatches[v], SYNTH_PATCH_MAX_SIZE, NULL, 0);
+        if (benchPatchSizes[v] < 0) {
+            printf("  FAILED, voice %d can't be written\n", v);
+            return 1;
+        }
+    }
+    benchSetupLoadedPatch();
+    int loads = 100000, res = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < loads; i++) {
+        res |= synthPatchApply(&benchSynth.voices[i & 1], benchPatches[i & 1], benchPatchSizes[i & 1], NULL, 0);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (res) {
+        printf("  FAILED, patches can't be loaded back\n");
+        return 1;
+    }
+    double ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / loads;
+    printf("  svf test patch is %d + %d bytes, %.0f ns to load a voice\n", benchPatchSizes[0], benchPatchSizes[1], ns);
+    return 0;
+}
+
+static void benchRenderNoisePatch(int32_t *mix, int n) {
+    brassNoiseRender(&benchSynth.voices[0], mix, n);
+    bassRender(&benchSynth.voices[1], mix, n);
+}
+
+static void benchSetupNoisePatch() {
+    brassNoiseInit(&benchSynth.voices[0]);
+    bassInit(&benchSynth.voices[1]);
+    benchStaticRender = benchRenderNoisePatch;
+}
+
+static void benchRenderDelayPatch(int32_t *mix, int n) {
+    pluckRender(&benchSynth.voices[0], mix, n);
+    bassEchoRender(&benchSynth.voices[1], mix, n);
+}
+
+static void benchSetupDelayPatch() {
+    synthDelayPoolInit(&benchSynth, 2, BENCH_DELAY_LENGTH);
+    pluckInit(&benchSynth.voices[0]);
+    bassEchoInit(&benchSynth.voices[1]);
+    benchStaticRender = benchRenderDelayPatch;
+}
+
+//the test patch with the brass voice at 2x and the bass at 4x
+static void benchSetupOversampledPatch() {
+    benchSetupTestPatch();
+    synthVoiceSetOversample(&benchSynth.voices[0], 1);
+    synthVoiceSetOversample(&benchSynth.voices[1], 2);
+}
+
+//the test patch with portamento on both voices, and the brass envelope attacking again from its level on each note
+static void benchSetupGlidePatch() {
+    benchSetupTestPatch();
+    benchSynth.voices[0].glide = SYNTH_MS(60);
+    benchSynth.voices[1].glide = SYNTH_MS(30);
+    synthNodeSetRetrigger(&benchSynth.voices[0].nodes[1], SYNTH_RETRIGGER_LEVEL);
+}
+
+static void benchInitBank() {
+    int size = 1 << BENCH_BANK_BITS;
+    for (int f = 0; f < 8; f++) {
+        int harmonics = 1 << f;
+        if (harmonics >= size / 2) {
+            harmonics = size / 2 - 1;
+        }
+        double frame[1 << BENCH_BANK_BITS], peak = 0;
+        for (int i = 0; i < size; i++) {
+            frame[i] = 0;
+            for (int h = 1; h <= harmonics; h++) {
+                frame[i] += sin(2 * M_PI * h * i / size) / h;
+            }
+            peak = fabs(frame[i]) > peak ? fabs(frame[i]) : peak;
+        }
+        for (int i = 0; i < size; i++) {
+            benchBankSamples[(f << BENCH_BANK_BITS) + i] = lrint(frame[i] / peak * Q15_MAX * .9);
+        }
+    }
+}
+
+//single node voices, so each node type can be timed on its own
+static q15_t (*benchWavegen)(q15_t input);
+static q15_t benchInput = Q15_MAX / 3;
+
+static void benchSetupOsc() {
+    SynthVoice_t *voice = &benchSynth.voices[0];
+    synthInitOscNode(&voice->nodes[0], NULL, &voice->phaseIncrement, NULL, benchWavegen);
+}
+
+static q15_t (*benchWavegenBl)(q15_t input, q15_t increment);
+
+static void benchSetupOscBl() {
+    SynthVoice_t *voice = &benchSynth.voices[0];
+    synthInitOscBlNode(&voice->nodes[0], NULL, &voice->phaseIncrement, NULL, benchWavegenBl);
+}
+
+static void benchSetupWavetable() {
+    SynthVoice_t *voice = &benchSynth.voices[0];
+    synthInitWavetableNode(&voice->nodes[0], NULL, &voice->phaseIncrement, NULL, &benchBank, &benchInput);
+}
+
+static void benchSetupEnvelope() {
+    synthInitEnvelopeNode(&benchSynth.voices[0].nodes[0], NULL, 500, 150, Q15_MAX * .8, 150);
+}
+
+static void benchSetupFilterLp() {
+    synthInitFilterLpNode(&benchSynth.voices[0].nodes[0], NULL, &benchInput, 8000);
+}
+
+static void benchSetupFilterHp() {
+    synthInitFilterHpNode(&benchSynth.voices[0].nodes[0], NULL, &benchInput, 8000);
+}
+
+static void benchSetupFilterSvf() {
+    synthInitFilterSvfNode(&benchSynth.voices[0].nodes[0], NULL, &benchInput, &svfCutoff, &svfResonance, SYNTH_SVF_LP);
+}
+
+static void benchSetupMixer() {
+    synthInitMixerNode(&benchSynth.voices[0].nodes[0], &half, &benchInput, &half, &vibratoInc);
+}
+
+static void benchSetupNoise() {
+    synthInitNoiseNode(&benchSynth.voices[0].nodes[0], &half, 1);
+}
+
+static void benchSetupDelay() {
+    synthDelayPoolInit(&benchSynth, 1, BENCH_DELAY_LENGTH);
+    synthInitDelayNode(&benchSynth.voices[0].nodes[0], NULL, &benchInput, &echoTime, &echoFeedback, &benchSynth.delayPool);
+}
+
+//benchChainLength nodes in each of benchVoiceCount voices, envelope -> oscillator -> filters,
+//alternating lp and hp with the last one as the output
+static int benchChainLength;
+static int benchVoiceCount;
+
+static void benchSetupChain() {
+    for (int v = 0; v < benchVoiceCount; v++) {
+        SynthVoice_t *voice = &benchSynth.voices[v];
+        int last = benchChainLength - 1;
+        if (benchChainLength == 1) {
+            synthInitOscNode(&voice->nodes[0], NULL, &voice->phaseIncrement, NULL, sawtoothWave);
+            continue;
+        }
+        synthInitEnvelopeNode(&voice->nodes[last], NULL, 500, 150, Q15_MAX * .8, 150);
+        synthInitOscNode(&voice->nodes[last - 1], &voice->nodes[last].output, &voice->phaseIncrement, NULL, sawtoothWave);
+        for (int i = last - 2; i >= 0; i--) {
+            if (i & 1) {
+                synthInitFilterHpNode(&voice->nodes[i], NULL, &voice->nodes[i + 1].output, 2000);
+            } else {
+                synthInitFilterLpNode(&voice->nodes[i], NULL, &voice->nodes[i + 1].output, 8000);
+            }
+        }
+    }
+}
+
+//naive 25% pulse, to compare with pulseWaveBl
+static q15_t benchPulseWave(q15_t input) {
+    return input < 0x2000 ? Q15_MAX : -Q15_MAX;
+}
+
+//harmonics to aliasing ratio of a wave generator in dB, at a phase increment of inc.
+//0x8000 samples is exactly inc cycles, so the harmonics below nyquist land on dft bins k * inc,
+//and everything else (apart from DC) is aliasing. bins are worked out with the goertzel algorithm
+#define BENCH_ALIAS_SAMPLES 0x8000
+//power in the harmonics of a wave with its fundamental on bin inc, over the power in everything else
+static double benchHarmonicRatio(const double *x, int inc) {
+    double total = 0, dc = 0, harmonics = 0;
+    for (int t = 0; t < BENCH_ALIAS_SAMPLES; t++) {
+        total += x[t] * x[t];
+        dc += x[t];
+    }
+    dc = dc * dc / BENCH_ALIAS_SAMPLES;
+    for (int bin = inc; bin < BENCH_ALIAS_SAMPLES / 2; bin += inc) {
+        double coeff = 2 * cos(2 * M_PI * bin / BENCH_ALIAS_SAMPLES);
+        double s1 = 0, s2 = 0;
+        for (int t = 0; t < BENCH_ALIAS_SAMPLES; t++) {
+            double s0 = x[t] + coeff * s1 - s2;
+            s2 = s1;
+            s1 = s0;
+        }
+        double power = s1 * s1 + s2 * s2 - coeff * s1 * s2;
+        harmonics += 2 * power / BENCH_ALIAS_SAMPLES;
+    }
+    return 10 * log10(harmonics / (total - dc - harmonics));
+}
+
+static double benchAliasing(q15_t (*wavegen)(q15_t input), q15_t (*wavegenBl)(q15_t input, q15_t increment), int inc) {
+    static double x[BENCH_ALIAS_SAMPLES];
+    int32_t phase = 0;
+    for (int t = 0; t < BENCH_ALIAS_SAMPLES; t++) {
+        x[t] = (wavegen ? wavegen(phase) : wavegenBl(phase, inc)) / 32768.0;
+        phase = (phase + inc) & 0x7FFF;
+    }
+    return benchHarmonicRatio(x, inc);
+}
+
+//the same for a voice playing a naive oscillator oversampled by shift, rendered with synthProcessBlock.
+//harmonics the decimator filters out above 0.4 of the sample rate don't count against it
+static double benchOversampledAliasing(q15_t (*wavegen)(q15_t input), int inc, int shift) {
+    static double x[BENCH_ALIAS_SAMPLES];
+    static q15_t out[BENCH_ALIAS_SAMPLES];
+    synthInit(&benchSynth, benchArena, sizeof(benchArena), 1);
+    SynthVoice_t *voice = synthVoiceAlloc(&benchSynth, 0, 1);
+    synthInitOscNode(&voice->nodes[0], NULL, &voice->phaseIncrement, NULL, wavegen);
+    synthVoiceSetOversample(voice, shift);
+    voice->phaseIncrement = (SynthPhase_t) (inc >> shift) << (SYNTH_PHASE_32 ? 17 : 0);
+    //let the decimators fill up first
+    synthProcessBlock(&benchSynth, out, 64);
+    synthProcessBlock(&benchSynth, out, BENCH_ALIAS_SAMPLES);
+    for (int t = 0; t < BENCH_ALIAS_SAMPLES; t++) {
+        x[t] = out[t] / 32768.0;
+    }
+    return benchHarmonicRatio(x, inc);
+}
+
+static void benchCheckAliasing() {
+    q15_t (*naive[])(q15_t input) = {sawtoothWave, squareWave, benchPulseWave};
+    q15_t (*bandLimited[])(q15_t input, q15_t increment) = {sawtoothWaveBl, squareWaveBl, pulseWaveBl};
+    const char *names[] = {"sawtooth", "square", "pulse 25%"};
+    //odd increments, so aliases don't land on harmonics
+    const int incs[] = {187, 743, 1487, 2973, 5945};
+    printf("  %-10s %8s %10s %10s\n", "wave", "Hz", "naive dB", "polyBLEP dB");
+    for (int w = 0; w < 3; w++) {
+        for (int k = 0; k < 5; k++) {
+            printf("  %-10s %8.0f %10.1f %10.1f\n", names[w], (double) incs[k] * SAMPLE_RATE / 0x8000,
+                    benchAliasing(naive[w], NULL, incs[k]), benchAliasing(NULL, bandLimited[w], incs[k]));
+        }
+    }
+    //multiples of 4 so the oversampled increments are exact, and odd once divided by 4 so aliases miss the harmonics
+    const int oversampledIncs[] = {748, 1484, 2972, 5948};
+    printf("\n  %-10s %8s %10s %10s %10s\n", "voice", "Hz", "1x dB", "2x dB", "4x dB");
+    for (int w = 0; w < 2; w++) {
+        for (int k = 0; k < 4; k++) {
+            printf("  %-10s %8.0f %10.1f %10.1f %10.1f\n", names[w], (double) oversampledIncs[k] * SAMPLE_RATE / 0x8000,
+                    benchOversampledAliasing(naive[w], oversampledIncs[k], 0), benchOversampledAliasing(naive[w], oversampledIncs[k], 1),
+                    benchOversampledAliasing(naive[w], oversampledIncs[k], 2));
+        }
+    }
+}
+
+//pitch error in cents of a phase increment
+static double benchCents(SynthPhase_t inc, double frequency) {
+#if SYNTH_PHASE_32
+    double cycle = 4294967296.0;
+#else
+    double cycle = 32768.0;
+#endif
+    return 1200 * log2((double) inc * SAMPLE_RATE / cycle / frequency);
+}
+
+//tuning error of midiToPhaseIncr and midiToPhaseIncrCents across the keyboard, and of a 5Hz LFO
+static void benchCheckTuning() {
+    const char *names[] = {"midiToPhaseIncr", "midiToPhaseIncrCents"};
+    const int ranges[][2] = {{12, 35}, {36, 59}, {60, 83}, {84, 107}};
+    printf("  %-22s %12s %14s %10s\n", "", "notes", "max cents off", "distinct");
+    for (int f = 0; f < 2; f++) {
+        for (int r = 0; r < 4; r++) {
+            double worst = 0;
+            int distinct = 0;
+            SynthPhase_t last = 0;
+            for (int note = ranges[r][0]; note <= ranges[r][1]; note++) {
+                SynthPhase_t inc = f ? midiToPhaseIncrCents(note, 0) : midiToPhaseIncr(note);
+                double error = fabs(benchCents(inc, 440 * pow(2, (note - 69) / 12.0)));
+                worst = error > worst ? error : worst;
+                distinct += inc != last;
+                last = inc;
+            }
+            printf("  %-22s %6d - %3d %14.1f %7d/24\n", names[f], ranges[r][0], ranges[r][1], worst, distinct);
+        }
+    }
+    printf("  5Hz LFO is %.1f cents off\n", benchCents(SYNTH_HZ_TO_INCREMENT(5), 5));
+}
+
+//check the block kernels against the scalar functions, every phase for the wave generators
+static int benchCheckKernels() {
+    q15_t (*wavegens[])(q15_t input) = {sawtoothWave, fallingWave, triangleWave, squareWave, expDecayWave, sineWave};
+    const char *waveNames[] = {"sawtooth", "falling", "triangle", "square", "expDecay", "sine"};
+    static q15_t phase[0x8000], out[0x8000], expected[0x8000], gain[0x8000];
+    int res = 0;
+    for (int i = 0; i < 0x8000; i++) {
+        phase[i] = i;
+    }
+    for (int w = 0; w < 6; w++) {
+        synthWaveBlock(wavegens[w], phase, out, 0x8000 - w); //odd sizes too, for the leftovers
+        int errors = 0;
+        for (int i = 0; i < 0x8000 - w; i++) {
+            errors += out[i] != wavegens[w](phase[i]);
+        }
+        if (errors) {
+            printf("  kernel %s: %d mismatches\n", waveNames[w], errors);
+            res = 1;
+        }
+    }
+
+    uint32_t seed = 1;
+    for (int i = 0; i < 0x8000; i++) {
+        seed = seed * 1664525 + 1013904223;
+        out[i] = seed >> 16;
+        gain[i] = seed;
+    }
+    gain[0] = Q15_MIN;
+    out[0] = Q15_MIN;
+    for (int step = 0; step < 2; step++) {
+        for (int i = 0; i < 0x8000; i++) {
+            expected[i] = (out[i] * gain[i * step]) >> 15;
+        }
+        synthGainBlock(out, gain, step, 0x8000 - 3);
+        if (memcmp(out, expected, (0x8000 - 3) * sizeof(q15_t))) {
+            printf("  kernel gain (step %d): mismatch\n", step);
+            res = 1;
+        }
+        memcpy(out, expected, sizeof(out));
+    }
+
+    const q15_t *inputs[3] = {out, gain, phase};
+    int steps[3] = {1, 1, 0};
+    for (int withGain = 0; withGain < 2; withGain++) {
+        const q15_t *g = withGain ? gain + 7 : NULL;
+        for (int i = 0; i < 0x8000 - 7; i++) {
+            int32_t sum = out[i] + gain[i] + phase[0];
+            expected[i] = g ? (sum * g[i]) >> 15 : sum;
+        }
+        q15_t *mixed = malloc(sizeof(out));
+        synthMixBlock(mixed, inputs, steps, g, 1, 0x8000 - 7);
+        if (memcmp(mixed, expected, (0x8000 - 7) * sizeof(q15_t))) {
+            printf("  kernel mixer (gain %d): mismatch\n", withGain);
+            res = 1;
+        }
+        free(mixed);
+    }
+    printf("  %s\n", res ? "FAILED" : "all kernels match the scalar code");
+    return res;
+}
+
+//the generator noise() used to be, the low half of a 32 bit LCG. bit 0 just alternates, bit 1 repeats every 4...
+static uint32_t benchLcgSeed = 0x12345678;
+
+static q15_t benchNoiseLcg() {
+    benchLcgSeed = benchLcgSeed * 1664525 + 1013904223;
+    return benchLcgSeed & 0xFFFF;
+}
+
+//the sine table clipper (SYNTH_CLIPPER_POLY 0)
+static q15_t benchClipSine(int32_t input) {
+    int sign = input < 0 ? -1 : 1;
+    int32_t a = (input > 0 ? input : -input) >> 3;
+    if (a > Q15_MAX / 4) {
+        a = Q15_MAX / 4;
+    }
+    return sineWaveInline(a) * sign;
+}
+
+static q15_t benchClipPoly(int32_t input) {
+    return softClipperInline(input);
+}
+
+static int32_t benchEnvelopeLinear(int32_t state) {
+    return (state & 0x7FFFFF) >> 4;
+}
+
+static int32_t benchEnvelopeSquared(int32_t state) {
+    return synthEnvelopeOutput(state, Q15_MAX);
+}
+
+#define BENCH_MATH_SAMPLES 4096
+#define BENCH_MATH_RUNS 512
+static volatile int32_t benchSink;
+
+static double benchNsSince(const struct timespec *start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return ((end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec)) / ((double) BENCH_MATH_SAMPLES * BENCH_MATH_RUNS);
+}
+
+//lag 1 correlation, and how often bit 0 flips (half the time for good noise)
+static void benchNoiseQuality(const char *name, double ns, const q15_t *samples, int n) {
+    double sum = 0, sumSq = 0, sumLag = 0;
+    int flips = 0;
+    for (int i = 0; i < n; i++) {
+        sum += samples[i];
+        sumSq += (double) samples[i] * samples[i];
+        if (i) {
+            sumLag += (double) samples[i] * samples[i - 1];
+            flips += (samples[i] ^ samples[i - 1]) & 1;
+        }
+    }
+    double mean = sum / n;
+    double var = sumSq / n - mean * mean;
+    double lag = (sumLag / (n - 1) - mean * mean) / var;
+    printf("  %-26s %9.2f   lag 1 correlation %6.3f, bit 0 flips %5.1f%%\n", name, ns, lag, 100.0 * flips / (n - 1));
+}
+
+static void benchClipQuality(const char *name, double ns, q15_t (*clip)(int32_t input)) {
+    //against the curve both aim for, a quarter sine reaching full scale at 2x q15
+    double worst = 0;
+    for (int32_t x = -0x10000; x <= 0x10000; x++) {
+        double ideal = Q15_MAX * sin(M_PI / 2 * x / 0x10000);
+        double err = fabs(clip(x) - ideal);
+        worst = err > worst ? err : worst;
+    }
+    printf("  %-26s %9.2f   max error %5.1f lsb\n", name, ns, worst);
+}
+
+//cost and accuracy of the noise, soft clipper and envelope curve kernels next to the ones they replaced
+//or could be replaced with, to pick the cheapest that's good enough for a target
+static void benchCheckMath() {
+    static q15_t samples[BENCH_MATH_SAMPLES];
+    static int32_t inputs[BENCH_MATH_SAMPLES];
+    struct timespec start;
+    int32_t sink = 0;
+    printf("  %-26s %9s\n", "kernel", "ns/sample");
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int run = 0; run < BENCH_MATH_RUNS; run++) {
+        for (int i = 0; i < BENCH_MATH_SAMPLES; i++) {
+            samples[i] = benchNoiseLcg();
+        }
+        sink += samples[run];
+    }
+    benchNoiseQuality("noise lcg low bits (old)", benchNsSince(&start), samples, BENCH_MATH_SAMPLES);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int run = 0; run < BENCH_MATH_RUNS; run++) {
+        for (int i = 0; i < BENCH_MATH_SAMPLES; i++) {
+            samples[i] = noise();
+        }
+        sink += samples[run];
+    }
+    benchNoiseQuality("noise() xorshift", benchNsSince(&start), samples, BENCH_MATH_SAMPLES);
+    uint32_t state = SYNTH_NOISE_SEED;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int run = 0; run < BENCH_MATH_RUNS; run++) {
+        state = synthNoiseBlock(state, samples, BENCH_MATH_SAMPLES);
+        sink += samples[run];
+    }
+    benchNoiseQuality("noise node block fill", benchNsSince(&start), samples, BENCH_MATH_SAMPLES);
+
+    q15_t (*clippers[])(int32_t input) = {benchClipSine, benchClipPoly};
+    const char *clipNames[] = {"clipper sine table", SYNTH_CLIPPER_POLY ? "clipper polynomial" : "clipper (poly off)"};
+    for (int c = 0; c < 2; c++) {
+        for (int i = 0; i < BENCH_MATH_SAMPLES; i++) {
+            inputs[i] = (i * 97) % 0x20000 - 0x10000;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int run = 0; run < BENCH_MATH_RUNS; run++) {
+            for (int i = 0; i < BENCH_MATH_SAMPLES; i++) {
+                samples[i] = clippers[c](inputs[i] + run);
+            }
+            sink += samples[run];
+        }
+        benchClipQuality(clipNames[c], benchNsSince(&start), clippers[c]);
+    }
+
+    int32_t (*curves[])(int32_t state) = {benchEnvelopeLinear, benchEnvelopeSquared};
+    const char *curveNames[] = {"envelope linear", "envelope squared"};
+    for (int c = 0; c < 2; c++) {
+        for (int i = 0; i < BENCH_MATH_SAMPLES; i++) {
+            inputs[i] = (i * 2047) & 0x7FFFFF;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int run = 0; run < BENCH_MATH_RUNS; run++) {
+            for (int i = 0; i < BENCH_MATH_SAMPLES; i++) {
+                samples[i] = curves[c](inputs[i] + run);
+            }
+            sink += samples[run];
+        }
+        printf("  %-26s %9.2f\n", curveNames[c], benchNsSince(&start));
+    }
+    benchSink = sink;
+}
+
+//how far the brass envelope drops when a held note is retriggered (e.g. a stolen voice), which is heard as a click
+static void benchCheckRetrigger() {
+    const char *names[] = {"reset (default)", "level"};
+    for (int c = 0; c < 2; c++) {
+        benchReset(1);
+        SynthVoice_t *voice = &benchSynth.voices[0];
+        brassInit(voice);
+        synthNodeSetRetrigger(&voice->nodes[1], c ? SYNTH_RETRIGGER_LEVEL : SYNTH_RETRIGGER_RESET);
+        synthVoiceNoteOn(voice, 60);
+        benchRender(BENCH_PER_SAMPLE, benchOut, BENCH_NOTE_SAMPLES);
+        q15_t before = voice->nodes[1].output, lowest = before;
+        synthVoiceNoteOn(voice, 67);
+        for (int t = 0; t < SYNTH_MS(50); t++) {
+            synthProcess(&benchSynth);
+            lowest = voice->nodes[1].output < lowest ? voice->nodes[1].output : lowest;
+        }
+        printf("  %-26s envelope at %5d drops to %5d\n", names[c], before, lowest);
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *csvPath = argc > 1 ? argv[1] : "bench.csv";
+    benchCsv = fopen(csvPath, "w");
+    if (benchCsv) {
+        fprintf(benchCsv, "case,renderer,ns_per_sample,samples_per_sec,cycles_per_sample\n");
+    } else {
+        printf("couldn't open %s, results won't be saved\n", csvPath);
+    }
+    benchReference = malloc(BENCH_SAMPLES * sizeof(q15_t));
+    benchOut = malloc(BENCH_SAMPLES * sizeof(q15_t));
+
+    benchInitBank();
+
+    printf("block kernels\n");
+    benchFailed |= benchCheckKernels();
+
+    printf("\ntuning, %d bit phase\n", SYNTH_PHASE_32 ? 32 : 15);
+    benchCheckTuning();
+
+    printf("\nharmonics to aliasing ratio\n");
+    benchCheckAliasing();
+
+    printf("\nmath kernels\n");
+    benchCheckMath();
+
+    printf("\nretriggering a held note\n");
+    benchCheckRetrigger();
+
+    printf("\npatch data\n");
+    benchFailed |= benchCheckPatches();
+
+    printf("\n  %-24s %-18s %10s %12s %14s\n", "case", "renderer", "ns/sample", "samples/sec", "cycles/sample");
+    printf("test.c patches\n");
+    for (int mode = BENCH_PER_SAMPLE; mode <= BENCH_PACK; mode++) {
+        benchMeasure("test patch", benchSetupTestPatch, 2, mode);
+    }
+    for (int mode = BENCH_PER_SAMPLE; mode <= BENCH_PACK; mode++) {
+        benchMeasure("test patch band limited", benchSetupBlPatch, 2, mode);
+    }
+    for (int mode = BENCH_PER_SAMPLE; mode <= BENCH_PACK; mode++) {
+        benchMeasure("test patch wavetable", benchSetupWtPatch, 2, mode);
+    }
+    for (int mode = BENCH_PER_SAMPLE; mode <= BENCH_PACK; mode++) {
+        benchMeasure("test patch svf", benchSetupSvfPatch, 2, mode);
+    }
+    //loaded from patch data, they have to play exactly the same
+    benchMeasure("test patch svf loaded", benchSetupLoadedPatch, 2, BENCH_BLOCK);
+    benchMeasure("test patch svf loaded", benchSetupLoadedPatch, 2, BENCH_PACK);
+    for (int mode = BENCH_PER_SAMPLE; mode <= BENCH_PACK; mode++) {
+        benchMeasure("test patch noise", benchSetupNoisePatch, 2, mode);
+    }
+    //gliding voices run a sample at a time in synthProcessBlock, and voice packs don't glide
+    for (int mode = BENCH_PER_SAMPLE; mode <= BENCH_STATIC; mode++) {
+        benchMeasure("test patch glide", benchSetupGlidePatch, 2, mode);
+    }
+    //voice packs don't do delay nodes
+    for (int mode = BENCH_PER_SAMPLE; mode <= BENCH_STATIC; mode++) {
+        benchMeasure("pluck and echo", benchSetupDelayPatch, 2, mode);
+    }
+    //compiled patches and voice packs don't oversample
+    for (int mode = BENCH_PER_SAMPLE; mode <= BENCH_BLOCK; mode++) {
+        benchMeasure("test patch oversampled", benchSetupOversampledPatch, 2, mode);
+    }
+    benchMeasure("test patch stereo", benchSetupStereoPatch, 2, BENCH_STEREO);
+    //compiled patches and voice packs don't do control rate nodes
+    for (int mode = BENCH_PER_SAMPLE; mode <= BENCH_BLOCK; mode++) {
+        benchMeasure("test patch control rate", benchSetupControlRatePatch, 2, mode);
+    }
+
+    printf("node types\n");
+    q15_t (*wavegens[])(q15_t input) = {sawtoothWave, fallingWave, triangleWave, squareWave, expDecayWave, sineWave};
+    const char *oscNames[] = {"oscillator sawtooth", "oscillator falling", "oscillator triangle",
+        "oscillator square", "oscillator expDecay", "oscillator sine"};
+    for (int w = 0; w < 6; w++) {
+        benchWavegen = wavegens[w];
+        for (int mode = BENCH_PER_SAMPLE; mode <= BENCH_BLOCK; mode++) {
+            benchMeasure(oscNames[w], benchSetupOsc, 1, mode);
+        }
+    }
+    q15_t (*wavegensBl[])(q15_t input, q15_t increment) = {sawtoothWaveBl, squareWaveBl, pulseWaveBl};
+    const char *oscBlNames[] = {"oscillator sawtooth bl", "oscillator square bl", "oscillator pulse bl"};
+    for (int w = 0; w < 3; w++) {
+        benchWavegenBl = wavegensBl[w];
+        for (int mode = BENCH_PER_SAMPLE; mode <= BENCH_BLOCK; mode++) {
+            benchMeasure(oscBlNames[w], benchSetupOscBl, 1, mode);
+        }
+    }
+    const char *nodeNames[] = {"wavetable", "envelope", "filter lp", "filter hp", "filter svf", "mixer", "noise", "delay"};
+    void (*nodeSetups[])() = {benchSetupWavetable, benchSetupEnvelope, benchSetupFilterLp, benchSetupFilterHp, benchSetupFilterSvf,
+        benchSetupMixer, benchSetupNoise, benchSetupDelay};
+    for (int c = 0; c < 8; c++) {
+        for (int mode = BENCH_PER_SAMPLE; mode <= BENCH_BLOCK; mode++) {
+            benchMeasure(nodeNames[c], nodeSetups[c], 1, mode);
+        }
+    }
+
+    printf("scaling, voices x nodes\n");
+    for (benchVoiceCount = 1; benchVoiceCount <= BENCH_VOICES; benchVoiceCount *= 2) {
+        for (benchChainLength = 1; benchChainLength <= SYNTH_NODES; benchChainLength *= 2) {
+            char name[32];
+            snprintf(name, sizeof(name), "%d voices x %d nodes", benchVoiceCount, benchChainLength);
+            for (int mode = BENCH_PER_SAMPLE; mode <= BENCH_BLOCK; mode++) {
+                benchMeasure(name, benchSetupChain, benchVoiceCount, mode);
+            }
+            benchMeasure(name, benchSetupChain, benchVoiceCount, BENCH_PACK);
+        }
+    }
+
+#if SYNTH_PROFILE
+    //the clock is read around every node, so this is slower than the timings above, but shows where time goes
+    const char *typeNames[SYNTH_NODE_END] = {"none", "oscillator", "envelope", "filter lp", "filter hp", "mixer", "oscillator bl", "wavetable",
+        "filter svf", "noise", "delay"};
+    printf("\nprofile, test.c patches with synthProcessBlock\n");
+    benchReset(2);
+    benchSetupTestPatch();
+    synthProfileReset();
+    benchPlay(BENCH_BLOCK, benchOut, 2);
+    for (int type = SYNTH_NODE_OSCILLATOR; type < SYNTH_NODE_END; type++) {
+        if (synthProfile.samples[type]) {
+            double perSample = (double) synthProfile.cycles[type] / synthProfile.samples[type];
+            printf("  %-12s %10.2f clocks per node sample\n", typeNames[type], perSample);
+            if (benchCsv) {
+                fprintf(benchCsv, "profile %s,synthProcessBlock,,,%.2f\n", typeNames[type], perSample);
+            }
+        }
+    }
+#endif
+
+    if (benchCsv) {
+        fclose(benchCsv);
+    }
+    free(benchReference);
+    free(benchOut);
+    return benchFailed;
+}
@@ -0,0 +1,442 @@
+#include "synth.h"
+#include "synth_poly.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "math.h"
+#include <sys/stat.h>
+
+//golden output check: renders a set of reference patches and note sequences, and compares a hash of each render with
+//the one stored in golden.txt for the config it was built with (sine table, interpolation, sample rate, phase bits).
+//anything that changes is reported, with the SNR against the render saved in golden_renders/ by the last --update if there is one
+//(golden.sh --baseline rev renders them from a git revision).
+//  ./golden            check against golden.txt
+//  ./golden --update   store this config's hashes (and renders) after a change that's meant to change the output
+//golden.sh builds and runs it for every config
+
+#define GOLDEN_FILE "golden.txt"
+#define GOLDEN_DIR "golden_renders"
+#define GOLDEN_LINE 160
+#define GOLDEN_MAX_LINES 1024
+
+#define GOLDEN_VOICES 4
+#define GOLDEN_NOTES 16
+#define GOLDEN_NOTE_SAMPLES (SAMPLE_RATE / 4)
+#define GOLDEN_SAMPLES (GOLDEN_NOTES * GOLDEN_NOTE_SAMPLES)
+
+static q15_t half = Q15_MAX / 2;
+static SynthPhase_t lfoPhaseInc = SYNTH_HZ_TO_INCREMENT(5);
+static q15_t vibratoInc = SYNTH_HZ_TO_PHASE(10);
+static q15_t svfResonance = Q15_MAX * .7;
+static q15_t svfCutoff = SYNTH_SVF_CUTOFF(800);
+
+#define GOLDEN_DELAY_LENGTH 4096
+static q15_t pluckTime = SYNTH_DELAY_TIME(SAMPLE_RATE / 220.0, GOLDEN_DELAY_LENGTH);
+static q15_t pluckFeedback = Q15_MAX * .99;
+static q15_t echoTime = SYNTH_DELAY_TIME(SAMPLE_RATE / 8, GOLDEN_DELAY_LENGTH);
+static q15_t echoFeedback = Q15_MAX * .4;
+
+static uint8_t goldenArena[SYNTH_ARENA_SIZE(GOLDEN_VOICES, GOLDEN_VOICES * SYNTH_NODES) + SYNTH_DELAY_POOL_SIZE(2, GOLDEN_DELAY_LENGTH)
+        + 2 * SYNTH_OVERSAMPLE_SIZE];
+static Synth_t goldenSynth;
+static SynthPoly_t goldenPoly;
+
+//4 frames going from a sine to a sawtooth, made with integer math so it comes out the same everywhere
+#define GOLDEN_BANK_BITS 6
+static q15_t goldenBankSamples[4 << GOLDEN_BANK_BITS];
+static const SynthWavetable_t goldenBank = SYNTH_WAVETABLE(goldenBankSamples, GOLDEN_BANK_BITS);
+
+static void goldenInitBank() {
+    for (int f = 0; f < 4; f++) {
+        for (int i = 0; i < 1 << GOLDEN_BANK_BITS; i++) {
+            q15_t phase = i << (15 - GOLDEN_BANK_BITS);
+            goldenBankSamples[(f << GOLDEN_BANK_BITS) + i] = (sineWave(phase) * (3 - f) + sawtoothWave(phase) * f) / 3;
+        }
+    }
+}
+
+//test.c's voices
+static void goldenBrass(SynthVoice_t *voice) {
+    synthInitEnvelopeNode(&voice->nodes[1], NULL, 500, 150, Q15_MAX * .8, 150);
+    synthInitOscNode(&voice->nodes[3], &voice->nodes[1].output, &voice->phaseIncrement, &voice->nodes[2].output, sawtoothWave);
+    synthInitOscNode(&voice->nodes[2], &vibratoInc, &lfoPhaseInc, NULL, sineWave);
+    synthInitFilterLpNode(&voice->nodes[0], NULL, &voice->nodes[3].output, 8000);
+}
+
+static void goldenBass(SynthVoice_t *voice) {
+    synthInitEnvelopeNode(&voice->nodes[1], NULL, 100, 500, Q15_MAX * 0.5, 15);
+    synthInitOscNode(&voice->nodes[2], &voice->nodes[1].output, &voice->phaseIncrement, NULL, squareWave);
+    synthInitFilterLpNode(&voice->nodes[0], NULL, &voice->nodes[2].output, 4000);
+}
+
+static void goldenSetupTestPatch() {
+    goldenBrass(&goldenSynth.voices[0]);
+    goldenBass(&goldenSynth.voices[1]);
+}
+
+static void goldenSetupBlPatch() {
+    SynthVoice_t *voice = &goldenSynth.voices[0];
+    synthInitEnvelopeNode(&voice->nodes[1], NULL, 500, 150, Q15_MAX * .8, 150);
+    synthInitOscNode(&voice->nodes[2], &vibratoInc, &lfoPhaseInc, NULL, sineWave);
+    synthInitOscBlNode(&voice->nodes[0], &voice->nodes[1].output, &voice->phaseIncrement, &voice->nodes[2].output, sawtoothWaveBl);
+    voice = &goldenSynth.voices[1];
+    synthInitEnvelopeNode(&voice->nodes[1], NULL, 100, 500, Q15_MAX * 0.5, 15);
+    synthInitOscBlNode(&voice->nodes[0], &voice->nodes[1].output, &voice->phaseIncrement, NULL, pulseWaveBl);
+}
+
+static void goldenSetupWtPatch() {
+    SynthVoice_t *voice = &goldenSynth.voices[0];
+    synthInitEnvelopeNode(&voice->nodes[1], NULL, 500, 150, Q15_MAX * .8, 150);
+    synthInitOscNode(&voice->nodes[2], &vibratoInc, &lfoPhaseInc, NULL, sineWave);
+    synthInitWavetableNode(&voice->nodes[0], &voice->nodes[1].output, &voice->phaseIncrement, &voice->nodes[2].output,
+            &goldenBank, &voice->nodes[1].output);
+    voice = &goldenSynth.voices[1];
+    synthInitEnvelopeNode(&voice->nodes[1], NULL, 100, 500, Q15_MAX * 0.5, 15);
+    synthInitWavetableNode(&voice->nodes[0], &voice->nodes[1].output, &voice->phaseIncrement, NULL, &goldenBank, &half);
+}
+
+static void goldenSetupSvfPatch() {
+    SynthVoice_t *voice = &goldenSynth.voices[0];
+    synthInitEnvelopeNode(&voice->nodes[1], NULL, 500, 150, Q15_MAX * .8, 150);
+    synthInitOscNode(&voice->nodes[2], &voice->nodes[1].output, &voice->phaseIncrement, NULL, sawtoothWave);
+    synthInitFilterSvfNode(&voice->nodes[0], NULL, &voice->nodes[2].output, &voice->nodes[1].output, &svfResonance, SYNTH_SVF_LP);
+    voice = &goldenSynth.voices[1];
+    synthInitEnvelopeNode(&voice->nodes[1], NULL, 100, 500, Q15_MAX * 0.5, 15);
+    synthInitOscNode(&voice->nodes[2], &voice->nodes[1].output, &voice->phaseIncrement, NULL, squareWave);
+    synthInitFilterSvfNode(&voice->nodes[3], NULL, &voice->nodes[2].output, &svfCutoff, &svfResonance, SYNTH_SVF_LP);
+    synthInitMixerNode(&voice->nodes[0], NULL, &voice->nodes[3].output, &voice->nodes[3].svf.outputs[SYNTH_SVF_BP], NULL);
+}
+
+static void goldenSetupNoisePatch() {
+    SynthVoice_t *voice = &goldenSynth.voices[0];
+    synthInitEnvelopeNode(&voice->nodes[1], NULL, 2000, 300, Q15_MAX / 4, 100);
+    synthInitNoiseNode(&voice->nodes[2], &voice->nodes[1].output, 1);
+    synthInitFilterHpNode(&voice->nodes[0], NULL, &voice->nodes[2].output, 2000);
+    goldenBass(&goldenSynth.voices[1]);
+}
+
+//a plucked string, noise bursts into a delay feeding back on itself, and the bass with an echo
+static void goldenSetupDelayPatch() {
+    synthDelayPoolInit(&goldenSynth, 2, GOLDEN_DELAY_LENGTH);
+    SynthVoice_t *voice = &goldenSynth.voices[0];
+    synthInitEnvelopeNode(&voice->nodes[2], NULL, 20000, 8000, 0, 8000);
+    synthInitNoiseNode(&voice->nodes[1], &voice->nodes[2].output, 1);
+    synthInitDelayNode(&voice->nodes[0], NULL, &voice->nodes[1].output, &pluckTime, &pluckFeedback, &goldenSynth.delayPool);
+    voice = &goldenSynth.voices[1];
+    synthInitEnvelopeNode(&voice->nodes[1], NULL, 100, 500, Q15_MAX * 0.5, 15);
+    synthInitOscNode(&voice->nodes[2], &voice->nodes[1].output, &voice->phaseIncrement, NULL, squareWave);
+    synthInitFilterLpNode(&voice->nodes[3], NULL, &voice->nodes[2].output, 4000);
+    synthInitDelayNode(&voice->nodes[4], NULL, &voice->nodes[3].output, &echoTime, &echoFeedback, &goldenSynth.delayPool);
+    synthInitMixerNode(&voice->nodes[0], &half, &voice->nodes[3].output, &voice->nodes[4].output, NULL);
+}
+
+static void goldenSetupControlRatePatch() {
+    goldenSetupTestPatch();
+    synthNodeSetRate(&goldenSynth.voices[0].nodes[1], 4);
+    synthNodeSetRate(&goldenSynth.voices[0].nodes[2], 4);
+    synthNodeSetRate(&goldenSynth.voices[1].nodes[1], 4);
+}
+
+static void goldenSetupStereoPatch() {
+    goldenSetupTestPatch();
+    goldenSynth.voices[0].pan = -Q15_MAX / 2;
+    goldenSynth.voices[1].pan = Q15_MAX / 3;
+}
+
+//a legato lead with a free running vibrato, and a bass that glides and bends
+static void goldenSetupGlidePatch() {
+    goldenSetupTestPatch();
+    goldenSynth.voices[0].legato = 1;
+    goldenSynth.voices[0].glide = SYNTH_MS(80);
+    synthNodeSetRetrigger(&goldenSynth.voices[0].nodes[1], SYNTH_RETRIGGER_LEVEL);
+    synthNodeSetRetrigger(&goldenSynth.voices[0].nodes[2], SYNTH_RETRIGGER_FREE);
+    goldenSynth.voices[1].glide = SYNTH_MS(40);
+}
+
+//the test patch with the brass at 2x and a gliding bass at 4x
+static void goldenSetupOversampledPatch() {
+    goldenSetupTestPatch();
+    synthVoiceSetOversample(&goldenSynth.voices[0], 1);
+    synthVoiceSetOversample(&goldenSynth.voices[1], 2);
+    goldenSynth.voices[1].glide = SYNTH_MS(40);
+}
+
+static void goldenSetupPolyPatch() {
+    for (int v = 0; v < GOLDEN_VOICES; v++) {
+        goldenBrass(&goldenSynth.voices[v]);
+    }
+    synthPolyInit(&goldenPoly, goldenSynth.voices, GOLDEN_VOICES, SYNTH_STEAL_QUIETEST);
+}
+
+//twinkle twinkle little star, with 0 as a rest
+static const uint8_t goldenMelody[GOLDEN_NOTES] = {60, 60, 67, 67, 69, 69, 67, 0, 65, 65, 64, 64, 62, 62, 60, 0};
+
+//a lead and a bass 2 octaves down, like test.c
+static void goldenNotesMelody(int step, int on) {
+    uint8_t note = goldenMelody[step];
+    if (!note) {
+        return;
+    }
+    if (on) {
+        synthVoiceNoteOn(&goldenSynth.voices[0], note);
+        synthVoiceNoteOn(&goldenSynth.voices[1], note - 24);
+    } else {
+        synthVoiceNoteOff(&goldenSynth.voices[0]);
+        synthVoiceNoteOff(&goldenSynth.voices[1]);
+    }
+}
+
+//the melody slurred: notes are only released before a rest, and the bass bends up a quarter tone mid note
+static void goldenNotesLegato(int step, int on) {
+    uint8_t note = goldenMelody[step];
+    if (!note) {
+        return;
+    }
+    if (on) {
+        synthVoiceNoteOn(&goldenSynth.voices[0], note);
+        synthVoiceNoteOn(&goldenSynth.voices[1], note - 24);
+    } else if (step % 2) {
+        synthVoiceBend(&goldenSynth.voices[1], 50);
+    }
+    if (!on && (step == GOLDEN_NOTES - 1 || !goldenMelody[step + 1])) {
+        synthVoiceNoteOff(&goldenSynth.voices[0]);
+        synthVoiceNoteOff(&goldenSynth.voices[1]);
+    }
+}
+
+//triads on each melody note, so releasing voices get stolen
+static void goldenNotesChords(int step, int on) {
+    uint8_t note = goldenMelody[step];
+    for (int k = 0; note && k < 3; k++) {
+        uint8_t chordNote = note + (k == 0 ? 0 : k == 1 ? 4 : 7);
+        if (on) {
+            synthPolyNoteOn(&goldenPoly, chordNote);
+        } else {
+            synthPolyNoteOff(&goldenPoly, chordNote);
+        }
+    }
+}
+
+enum {
+    GOLDEN_PER_SAMPLE,
+    GOLDEN_BLOCK,
+    GOLDEN_STEREO,
+};
+
+typedef struct GoldenCase {
+    const char *name;
+    void (*setup)();
+    void (*notes)(int step, int on);
+    int stereo;
+    int idleDrift; //synthProcessBlock only has to match synthProcess until the lead (voice 0) has gone idle
+} GoldenCase_t;
+
+static const GoldenCase_t goldenCases[] = {
+    {"test_patch", goldenSetupTestPatch, goldenNotesMelody, 0, 0},
+    {"band_limited", goldenSetupBlPatch, goldenNotesMelody, 0, 0},
+    {"wavetable", goldenSetupWtPatch, goldenNotesMelody, 0, 0},
+    {"svf", goldenSetupSvfPatch, goldenNotesMelody, 0, 0},
+    //noise carries on from wherever a voice went idle, which is only checked at the end of a block with
+    //synthProcessBlock, so the renders part ways at the next note
+    {"noise", goldenSetupNoisePatch, goldenNotesMelody, 0, 1},
+    {"delay", goldenSetupDelayPatch, goldenNotesMelody, 0, 1},
+    {"control_rate", goldenSetupControlRatePatch, goldenNotesMelody, 0, 0},
+    //a free running LFO carries on from where the voice went idle too
+    {"glide", goldenSetupGlidePatch, goldenNotesLegato, 0, 1},
+    {"oversampled", goldenSetupOversampledPatch, goldenNotesMelody, 0, 0},
+    {"poly", goldenSetupPolyPatch, goldenNotesChords, 0, 0},
+    {"stereo", goldenSetupStereoPatch, goldenNotesMelody, 1, 0},
+};
+#define GOLDEN_CASES (int) (sizeof(goldenCases) / sizeof(goldenCases[0]))
+
+static void goldenRenderPart(int mode, q15_t *out, int n) {
+    if (mode == GOLDEN_STEREO) {
+        synthProcessBlockStereo(&goldenSynth, out, n);
+    } else if (mode == GOLDEN_BLOCK) {
+        synthProcessBlock(&goldenSynth, out, n);
+    } else {
+        for (int t = 0; t < n; t++) {
+            out[t] = synthProcess(&goldenSynth);
+        }
+    }
+}
+
+//the step the lead first went idle in during the last render, or GOLDEN_NOTES
+static int goldenIdleStep;
+
+//play a case from scratch, notes are held for 3/4 of each step. returns the number of samples (values for stereo)
+static int goldenRender(const GoldenCase_t *c, int mode, q15_t *out) {
+    synthInit(&goldenSynth, goldenArena, sizeof(goldenArena), GOLDEN_VOICES);
+    for (int v = 0; v < GOLDEN_VOICES; v++) {
+        synthVoiceAlloc(&goldenSynth, v, SYNTH_NODES);
+    }
+    c->setup();
+    int channels = mode == GOLDEN_STEREO ? 2 : 1;
+    int held = GOLDEN_NOTE_SAMPLES * 3 / 4;
+    goldenIdleStep = GOLDEN_NOTES;
+    for (int step = 0; step < GOLDEN_NOTES; step++) {
+        q15_t *stepOut = out + step * GOLDEN_NOTE_SAMPLES * channels;
+        c->notes(step, 1);
+        goldenRenderPart(mode, stepOut, held);
+        c->notes(step, 0);
+        goldenRenderPart(mode, stepOut + held * channels, GOLDEN_NOTE_SAMPLES - held);
+        if (goldenIdleStep == GOLDEN_NOTES && goldenSynth.voices[0].idle) {
+            goldenIdleStep = step;
+        }
+    }
+    return GOLDEN_SAMPLES * channels;
+}
+
+//FNV-1a over the samples as little endian bytes
+static uint64_t goldenHash(const q15_t *samples, int n) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (int i = 0; i < n; i++) {
+        uint16_t sample = samples[i];
+        hash = (hash ^ (sample & 0xFF)) * 0x100000001B3ULL;
+        hash = (hash ^ (sample >> 8)) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static char goldenConfig[64];
+
+static void goldenRawPath(char *path, size_t size, const char *name) {
+    snprintf(path, size, GOLDEN_DIR "/lut8-%d_interp-%d_rate-%d_phase32-%d_%s.raw", SYNTH_SINE_LUT_8BIT, SYNTH_INTERPOLATE,
+            SAMPLE_RATE, SYNTH_PHASE_32, name);
+}
+
+//how far a render drifted from the saved one
+static void goldenReportDrift(const char *name, const q15_t *samples, int n) {
+    char path[GOLDEN_LINE];
+    goldenRawPath(path, sizeof(path), name);
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        printf("(no render saved in " GOLDEN_DIR "/ to compare with, see golden.sh --baseline)\n");
+        return;
+    }
+    q15_t *saved = malloc(n * sizeof(q15_t));
+    int count = fread(saved, sizeof(q15_t), n, file);
+    fclose(file);
+    if (count != n) {
+        printf("(the saved render is a different length)\n");
+        free(saved);
+        return;
+    }
+    double signal = 0, noise = 0;
+    int worst = 0, differ = 0;
+    for (int i = 0; i < n; i++) {
+        int err = abs(samples[i] - saved[i]);
+        signal += (double) saved[i] * saved[i];
+        noise += (double) err * err;
+        worst = err > worst ? err : worst;
+        differ += err != 0;
+    }
+    printf("snr %.1f dB, max error %d lsb, %d of %d samples differ\n", 10 * log10(signal / noise), worst, differ, n);
+    free(saved);
+}
+
+static void goldenSaveRender(const char *name, const q15_t *samples, int n) {
+    char path[GOLDEN_LINE];
+    goldenRawPath(path, sizeof(path), name);
+    mkdir(GOLDEN_DIR, 0755);
+    FILE *file = fopen(path, "wb");
+    if (!file || fwrite(samples, sizeof(q15_t), n, file) != (size_t) n) {
+        printf("  couldn't save %s\n", path);
+    }
+    if (file) {
+        fclose(file);
+    }
+}
+
+static int goldenCompareLines(const void *a, const void *b) {
+    return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+int main(int argc, char **argv) {
+    int update = argc > 1 && !strcmp(argv[1], "--update");
+    snprintf(goldenConfig, sizeof(goldenConfig), "lut8=%d interp=%d rate=%d phase32=%d", SYNTH_SINE_LUT_8BIT, SYNTH_INTERPOLATE,
+            SAMPLE_RATE, SYNTH_PHASE_32);
+    printf("config %s\n", goldenConfig);
+    goldenInitBank();
+
+    //every line of golden.txt, "config case hash"
+    static char lines[GOLDEN_MAX_LINES][GOLDEN_LINE];
+    int lineCount = 0;
+    FILE *file = fopen(GOLDEN_FILE, "r");
+    while (file && lineCount < GOLDEN_MAX_LINES && fgets(lines[lineCount], GOLDEN_LINE, file)) {
+        lines[lineCount][strcspn(lines[lineCount], "\n")] = 0;
+        if (lines[lineCount][0]) {
+            lineCount++;
+        }
+    }
+    if (file) {
+        fclose(file);
+    }
+
+    static q15_t reference[GOLDEN_SAMPLES * 2], out[GOLDEN_SAMPLES * 2];
+    int failed = 0;
+    char results[GOLDEN_CASES][GOLDEN_LINE];
+    for (int c = 0; c < GOLDEN_CASES; c++) {
+        const GoldenCase_t *gc = &goldenCases[c];
+        int n;
+        if (gc->stereo) {
+            n = goldenRender(gc, GOLDEN_STEREO, reference);
+        } else {
+            //the renderers have to agree before the output is worth comparing
+            n = goldenRender(gc, GOLDEN_PER_SAMPLE, reference);
+            int exact = gc->idleDrift && goldenIdleStep < GOLDEN_NOTES ? (goldenIdleStep + 1) * GOLDEN_NOTE_SAMPLES : n;
+            goldenRender(gc, GOLDEN_BLOCK, out);
+            if (memcmp(reference, out, exact * sizeof(q15_t))) {
+                printf("  %-14s synthProcessBlock doesn't match synthProcess\n", gc->name);
+                failed = 1;
+            }
+        }
+        snprintf(results[c], GOLDEN_LINE, "%s %s %016llx", goldenConfig, gc->name, (unsigned long long) goldenHash(reference, n));
+        if (update) {
+            goldenSaveRender(gc->name, reference, n);
+            continue;
+        }
+        const char *golden = NULL;
+        size_t prefix = strlen(goldenConfig) + 1 + strlen(gc->name) + 1;
+        for (int k = 0; k < lineCount && !golden; k++) {
+            if (!strncmp(lines[k], results[c], prefix)) {
+                golden = lines[k];
+            }
+        }
+        if (!golden) {
+            printf("  %-14s no golden, run with --update\n", gc->name);
+            failed = 1;
+        } else if (strcmp(golden, results[c])) {
+            printf("  %-14s CHANGED ", gc->name);
+            goldenReportDrift(gc->name, reference, n);
+            failed = 1;
+        } else {
+            printf("  %-14s ok\n", gc->name);
+        }
+    }
+
+    if (update) {
+        //replace this config's lines, and keep the file sorted so updates diff cleanly
+        static char *sorted[GOLDEN_MAX_LINES + GOLDEN_CASES];
+        int count = 0;
+        for (int k = 0; k < lineCount; k++) {
+            if (strncmp(lines[k], goldenConfig, strlen(goldenConfig)) || lines[k][strlen(goldenConfig)] != ' ') {
+                sorted[count++] = lines[k];
+            }
+        }
+        for (int c = 0; c < GOLDEN_CASES; c++) {
+            sorted[count++] = results[c];
+        }
+        qsort(sorted, count, sizeof(char *), goldenCompareLines);
+        file = fopen(GOLDEN_FILE, "w");
+        for (int k = 0; file && k < count; k++) {
+            fprintf(file, "%s\n", sorted[k]);
+        }
+        if (!file || fclose(file)) {
+            printf("  couldn't write " GOLDEN_FILE "\n");
+            return 1;
+        }
+        printf("  updated %d cases\n", GOLDEN_CASES);
+    }
+    return failed;
+}
@@ -0,0 +1,66 @@
+#!/bin/sh
+#builds golden.c for every config and checks each against golden.txt, or with --update stores them all.
+#with --baseline rev, it first renders every config with the golden.c and sources of that git revision into
+#golden_renders/, so whatever drifted is reported with its SNR against rev, e.g. on a fresh checkout:
+#  ./golden.sh --baseline HEAD
+#run it from the top of the repo. exits 1 if anything drifted
+cd "$(dirname "$0")" || exit 1
+BIN="${TMPDIR:-/tmp}/golden_$$"
+FAILED=0
+
+#runs "$@" once for each config, with FLAGS set to its defines
+eachConfig() {
+    for RATE in 8000 11025 22050; do
+        for LUT in 0 1; do
+            for INTERP in 0 1; do
+                for PHASE in 0 1; do
+                    FLAGS="-DSAMPLE_RATE=$RATE -DSYNTH_SINE_LUT_8BIT=$LUT -DSYNTH_INTERPOLATE=$INTERP -DSYNTH_PHASE_32=$PHASE"
+                    "$@"
+                done
+            done
+        done
+    done
+}
+
+baselineConfig() {
+    if ! (cd "$BASE" && gcc -O2 $FLAGS golden.c src/*.c -I src -lm -pthread -o "$BIN" && "$BIN" --update > /dev/null); then
+        echo "couldn't render $FLAGS at $REV"
+        FAILED=1
+    fi
+}
+
+checkConfig() {
+    if ! gcc -O2 $FLAGS golden.c src/synth.c src/synth_simd.c src/synth_poly.c -I src -lm -o "$BIN"; then
+        FAILED=1
+        return
+    fi
+    "$BIN" "$@" || FAILED=1
+}
+
+if [ "$1" = "--baseline" ]; then
+    REV="${2:-HEAD}"
+    shift
+    [ $# -gt 0 ] && shift
+    BASE="${TMPDIR:-/tmp}/golden_base_$$"
+    mkdir -p "$BASE"
+    if ! git archive "$REV" | tar -x -C "$BASE"; then
+        echo "couldn't get $REV"
+        rm -rf "$BASE"
+        exit 1
+    fi
+    eachConfig baselineConfig
+    mkdir -p golden_renders
+    cp "$BASE"/golden_renders/*.raw golden_renders/ 2> /dev/null || FAILED=1
+    rm -rf "$BASE"
+    if [ $FAILED != 0 ]; then
+        rm -f "$BIN"
+        echo "couldn't render the baseline"
+        exit 1
+    fi
+    echo "baseline renders from $REV in golden_renders/"
+fi
+
+eachConfig checkConfig "$@"
+rm -f "$BIN"
+[ $FAILED = 0 ] && echo "all configs match" || echo "some configs drifted"
+exit $FAILED
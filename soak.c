@@ -0,0 +1,105 @@
+#include "synth.h"
+#include "synth_events.h"
+#include "synth_poly.h"
+#include "synth_host.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include <time.h>
+
+//real time soak test: plays a poly pool of the test.c brass voice through synth_host.c for a while, with notes
+//pushed from this thread as a MIDI handler would, then prints the underruns, xruns and latency histogram.
+//  ./soak [sink] [seconds] [voices] [periods]
+//sink is null (the default), alsa, alsa:device, or a file or named pipe to write raw pcm to ("-" for stdout), e.g.
+//  ./soak - 10 | aplay -f S16_LE -r 11025
+//exits 1 if there were any underruns or xruns, or the event queue was too full to take a note
+
+#define SOAK_VOICES 16
+
+q15_t vibratoInc = SYNTH_HZ_TO_PHASE(10);
+SynthPhase_t lfoPhaseInc = SYNTH_HZ_TO_INCREMENT(5);
+
+static uint8_t arena[SYNTH_ARENA_SIZE(SOAK_VOICES, SOAK_VOICES * 4)];
+static Synth_t synth;
+static SynthPoly_t poly;
+static SynthEventQueue_t events;
+
+static void soakBrass(SynthVoice_t *voice) {
+    synthInitEnvelopeNode(&voice->nodes[1], NULL, 500, 150, Q15_MAX * .8, 150);
+    synthInitOscNode(&voice->nodes[2], &vibratoInc, &lfoPhaseInc, NULL, sineWave);
+    synthInitOscNode(&voice->nodes[3], &voice->nodes[1].output, &voice->phaseIncrement, &voice->nodes[2].output, sawtoothWave);
+    synthInitFilterLpNode(&voice->nodes[0], NULL, &voice->nodes[3].output, 8000);
+}
+
+static void soakSleep(double seconds) {
+    struct timespec ts = {.tv_sec = (time_t) seconds, .tv_nsec = (long) ((seconds - (time_t) seconds) * 1e9)};
+    nanosleep(&ts, NULL);
+}
+
+int main(int argc, char **argv) {
+    const char *sinkName = argc > 1 ? argv[1] : "null";
+    double seconds = argc > 2 ? atof(argv[2]) : 5;
+    int voiceCount = argc > 3 ? atoi(argv[3]) : 8;
+    int periods = argc > 4 ? atoi(argv[4]) : 4;
+    if (voiceCount < 1 || voiceCount > SOAK_VOICES) {
+        fprintf(stderr, "voices must be 1 to %d\n", SOAK_VOICES);
+        return 1;
+    }
+
+    synthInit(&synth, arena, sizeof(arena), voiceCount);
+    for (int v = 0; v < voiceCount; v++) {
+        soakBrass(synthVoiceAlloc(&synth, v, 4));
+    }
+    synthPolyInit(&poly, synth.voices, voiceCount, SYNTH_STEAL_OLDEST);
+    synthEventInit(&events);
+
+    SynthHostSink_t sink = SYNTH_HOST_FILE;
+    const char *name = sinkName;
+    if (!strcmp(sinkName, "null")) {
+        sink = SYNTH_HOST_NULL;
+    } else if (!strncmp(sinkName, "alsa", 4)) {
+        sink = SYNTH_HOST_ALSA_PCM;
+        name = sinkName[4] == ':' ? sinkName + 5 : NULL;
+    }
+    SynthHost_t *host = synthHostOpen(&synth, &events, sink, name, periods);
+    if (!host) {
+        fprintf(stderr, "couldn't start playing to %s\n", sinkName);
+        return 1;
+    }
+
+    //an arpeggio an eighth of a second a note, each note held for as long as there are voices to play it,
+    //stamped a little after the render thread's clock so it lands on the next period
+    const uint8_t chord[] = {48, 55, 60, 64, 67, 72, 76, 79};
+    int steps = seconds * 8;
+    uint32_t dropped = 0; //notes the queue had no room for
+    for (int i = 0; i < steps; i++) {
+        uint32_t time = synthEventTime(&events) + SYNTH_HOST_PERIOD;
+        if (i >= voiceCount) {
+            dropped += !synthEventPolyNoteOff(&events, time, &poly, chord[(i - voiceCount) % 8] + 12 * ((i - voiceCount) / 8 % 2));
+        }
+        dropped += !synthEventPolyNoteOn(&events, time, &poly, chord[i % 8] + 12 * (i / 8 % 2));
+        soakSleep(.125);
+    }
+
+    SynthHostStats_t stats;
+    synthHostStats(host, &stats);
+    int res = synthHostClose(host);
+    if (res) {
+        fprintf(stderr, "writing to %s failed\n", sinkName);
+    }
+
+    //stdout may be the audio, so the report goes to stderr
+    double periodMs = SYNTH_HOST_PERIOD * 1000.0 / SAMPLE_RATE;
+    fprintf(stderr, "%s, %d voices, %d periods of %d samples queued (%.1f ms)\n", sinkName, voiceCount, periods,
+            SYNTH_HOST_PERIOD, periods * periodMs);
+    fprintf(stderr, "played %.2f s, %u periods rendered, the longest in %.3f ms of %.3f ms\n",
+            (double) stats.samples / SAMPLE_RATE, stats.periods, stats.renderMax / 1000.0, periodMs);
+    fprintf(stderr, "underruns %u, xruns %u, dropped events %u\n", stats.underruns, stats.xruns, dropped);
+    fprintf(stderr, "time from render to play:\n");
+    for (int k = 0; k < SYNTH_HOST_HISTOGRAM; k++) {
+        if (stats.latency[k]) {
+            fprintf(stderr, "  %8.3f to %8.3f ms %8u\n", k ? (1 << k) / 1000.0 : 0, (2 << k) / 1000.0, stats.latency[k]);
+        }
+    }
+    return res || stats.underruns || stats.xruns || dropped;
+}
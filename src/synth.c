@@ -2,13 +2,50 @@
 // 2025 Ben Hencke
 
 #include "synth.h"
+#include "synth_inline.h"
+#include "synth_simd.h"
 #include "string.h"
 
 
-SynthVoice_t synthVoices[SYNTH_VOICES];
-SynthNode_t synthNodes[SYNTH_VOICES][SYNTH_NODES];
+#if SYNTH_PROFILE
+#ifndef SYNTH_PROFILE_CLOCK
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__)
+#define SYNTH_PROFILE_CLOCK() (*(volatile uint32_t *) 0xE0001004) //DWT->CYCCNT
+#define SYNTH_PROFILE_DWT 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SYNTH_PROFILE_CLOCK() __rdtsc()
+#else
+#include <time.h>
+static uint64_t synthProfileClock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#define SYNTH_PROFILE_CLOCK() synthProfileClock()
+#endif
+#endif
 
-const int synthNodesSize = sizeof(synthNodes);
+SynthProfile_t synthProfile;
+
+void synthProfileReset() {
+#if SYNTH_PROFILE_DWT
+    *(volatile uint32_t *) 0xE000EDFC |= 1 << 24; //CoreDebug->DEMCR TRCENA
+    *(volatile uint32_t *) 0xE0001000 |= 1; //DWT->CTRL CYCCNTENA
+#endif
+    memset(&synthProfile, 0, sizeof(synthProfile));
+}
+
+//time a statement and charge it to a node type
+#define SYNTH_PROFILE_RUN(type, count, statement) do { \
+        uint32_t profileStart = SYNTH_PROFILE_CLOCK(); \
+        statement; \
+        synthProfile.cycles[type] += (uint32_t) SYNTH_PROFILE_CLOCK() - profileStart; \
+        synthProfile.samples[type] += count; \
+    } while (0)
+#else
+#define SYNTH_PROFILE_RUN(type, count, statement) statement
+#endif
 
 //store the phase increments for each note for the highest notes, which will have the largest phase increments
 //then divide them by 2 for each octave below that
@@ -29,31 +66,223 @@ const q15_t octavePhases[12] = {
     SYNTH_HZ_TO_PHASE(7902.13), //B
 };
 
-q15_t midiToPhaseIncr(uint8_t note) {
+//the same for midiToPhaseIncrCents, but as 32 bit phase increments (a cycle is 2^32) for C7 to B7 (midi 96 to 107)
+#define FINE_OCTAVE 8
+#define FINE_PHASE(frequency) ((uint32_t) ((frequency) * 4294967296.0 / SAMPLE_RATE + 0.5))
+static const uint32_t fineOctavePhases[13] = {
+    FINE_PHASE(2093.004522), //C
+    FINE_PHASE(2217.461048), //C#
+    FINE_PHASE(2349.318143), //D
+    FINE_PHASE(2489.015870), //D#
+    FINE_PHASE(2637.020455), //E
+    FINE_PHASE(2793.825851), //F
+    FINE_PHASE(2959.955382), //F#
+    FINE_PHASE(3135.963488), //G
+    FINE_PHASE(3322.437581), //G#
+    FINE_PHASE(3520.000000), //A
+    FINE_PHASE(3729.310092), //A#
+    FINE_PHASE(3951.066410), //B
+};
+
+SynthPhase_t midiToPhaseIncr(uint8_t note) {
+#if SYNTH_PHASE_32
+    return midiToPhaseIncrCents(note, 0);
+#else
     int octave = note / 12;
     int noteIndex = note - (octave * 12);
     q15_t phaseIncr = octavePhases[noteIndex];
 
     phaseIncr >>= (BASE_OCTAVE - octave + 1);
     return phaseIncr;
+#endif
+}
+
+SynthPhase_t midiToPhaseIncrCents(uint8_t note, int32_t cents) {
+    int32_t pitch = note * 100 + cents;
+    if (pitch < 0) {
+        pitch = 0;
+    } else if (pitch > 127 * 100 + 99) {
+        pitch = 127 * 100 + 99;
+    }
+    int semitone = pitch / 100;
+    int fraction = pitch - semitone * 100;
+    int octave = semitone / 12;
+    uint64_t phaseIncr = fineOctavePhases[semitone - octave * 12];
+    //up by 2^(fraction / 1200), as 1 + x + x^2 / 2 with x = fraction * ln(2) / 1200 in 16 bit fixed point
+    uint32_t x = (fraction * 9691) >> 8;
+    phaseIncr = (phaseIncr * (65536 + x + ((x * x) >> 17))) >> 16;
+    //move to the note's octave, rounding down to the precision we have
+    int shift = FINE_OCTAVE - octave;
+#if !SYNTH_PHASE_32
+    shift += 17;
+#endif
+    if (shift > 0) {
+        phaseIncr = (phaseIncr + (1ULL << (shift - 1))) >> shift;
+    } else {
+        phaseIncr <<= -shift;
+    }
+#if SYNTH_PHASE_32
+    return phaseIncr > 0xFFFFFFFF ? 0xFFFFFFFF : phaseIncr;
+#else
+    return phaseIncr > Q15_MAX ? Q15_MAX : phaseIncr;
+#endif
+}
+
+void *synthArenaAlloc(Synth_t *synth, size_t size) {
+    size = SYNTH_ARENA_ROUND(size);
+    if (size > synth->arenaSize - synth->arenaUsed) {
+        return NULL;
+    }
+    void *res = synth->arena + synth->arenaUsed;
+    synth->arenaUsed += size;
+    memset(res, 0, size);
+    return res;
+}
+
+int synthInit(Synth_t *synth, void *arena, size_t size, int voiceCount) {
+    memset(synth, 0, sizeof(Synth_t));
+    //align the start, so everything taken from the arena is
+    uintptr_t start = ((uintptr_t) arena + SYNTH_ARENA_ALIGN - 1) & ~(uintptr_t) (SYNTH_ARENA_ALIGN - 1);
+    size_t skip = start - (uintptr_t) arena;
+    if (voiceCount < 0 || voiceCount > 0xFFFF || skip > size) {
+        return -1;
+    }
+    synth->arena = (uint8_t *) start;
+    synth->arenaSize = size - skip;
+    synth->voices = synthArenaAlloc(synth, voiceCount * sizeof(SynthVoice_t));
+    if (!synth->voices) {
+        return -1;
+    }
+    synth->voiceCount = voiceCount;
+    synth->mixGain = voiceCount > 1 ? Q15_MAX / voiceCount : Q15_MAX;
+    for (int vi = 0; vi < voiceCount; vi++) {
+        synth->voices[vi].synth = synth;
+    }
+    return 0;
+}
+
+int synthDelayPoolInit(Synth_t *synth, int lines, int length) {
+    SynthDelayPool_t *pool = &synth->delayPool;
+    if (pool->samples || lines < 1 || lines > SYNTH_DELAY_LINES || length < 2 || length > 32768 || (length & (length - 1))) {
+        return -1;
+    }
+    pool->samples = synthArenaAlloc(synth, SYNTH_DELAY_POOL_SIZE(lines, length));
+    if (!pool->samples) {
+        return -1;
+    }
+    pool->lineLength = length;
+    pool->lineCount = lines;
+    return 0;
+}
+
+SynthVoice_t *synthVoiceAlloc(Synth_t *synth, int index, int nodeCount) {
+    if (index < 0 || index >= synth->voiceCount || nodeCount < 0 || nodeCount > SYNTH_NODES) {
+        return NULL;
+    }
+    SynthVoice_t *voice = &synth->voices[index];
+    if (voice->nodes) {
+        return NULL;
+    }
+    SynthNode_t *nodes = synthArenaAlloc(synth, nodeCount * sizeof(SynthNode_t));
+    if (!nodes) {
+        return NULL;
+    }
+    for (int i = 0; i < nodeCount; i++) {
+        nodes[i].voice = voice;
+    }
+    voice->nodes = nodes;
+    voice->nodeCapacity = nodeCount;
+    voice->rewired = 1;
+    return voice;
+}
+
+//head for target over samples samples from the pitch the voice is at now, or jump there
+static void synthVoiceGlideTo(SynthVoice_t *voice, SynthPhase_t target, int samples) {
+    voice->glideTarget = target;
+    if (samples <= 1 || voice->phaseIncrement == target) {
+        voice->phaseIncrement = target;
+        voice->glideLeft = 0;
+        return;
+    }
+    voice->glideAt = (uint32_t) voice->phaseIncrement << SYNTH_GLIDE_SHIFT;
+    voice->glideStep = ((int64_t) ((uint32_t) target << SYNTH_GLIDE_SHIFT) - voice->glideAt) / samples;
+    voice->glideLeft = samples;
 }
 
 void synthVoiceNoteOn(SynthVoice_t *voice, uint8_t note) {
+    //glide from the pitch it's playing, unless it has gone quiet (or never played)
+    int sounding = !voice->idle && voice->phaseIncrement;
+    int legato = voice->legato && voice->gate;
     voice->note = note;
     voice->gate = 1;
-    voice->phaseIncrement = midiToPhaseIncr(note);
-    //reset the state of all nodes
-    for (int i = 0; i < SYNTH_NODES; i++) {
+    voice->idle = 0;
+    int glide = sounding ? voice->glide << voice->oversample : 0;
+    synthVoiceGlideTo(voice, midiToPhaseIncr(note) >> voice->oversample, glide < 0xFFFF ? glide : 0xFFFF);
+    if (legato) {
+        return;
+    }
+    for (int i = 0; i < voice->nodeCapacity; i++) {
         SynthNode_t *node = &voice->nodes[i];
+        if (node->retrigger == SYNTH_RETRIGGER_FREE || node->type == SYNTH_NODE_NOISE) {
+            continue;
+        }
+        if (node->retrigger == SYNTH_RETRIGGER_LEVEL && node->type == SYNTH_NODE_ENVELOPE) {
+            //back to attack, from the level it's at
+            node->state &= 0x7FFFFFFF;
+            continue;
+        }
         node->state = 0;
+        node->tick = 0;
+        if (node->rate) {
+            //the first ramp starts from here, not from wherever the last note left off
+            node->output = 0;
+        }
     }
 }
 void synthVoiceNoteOff(SynthVoice_t *voice) {
     voice->gate = 0;
 }
 
-void synthInitOscNode(SynthNode_t *node, q15_t *gain, q15_t *phaseIncrement, q15_t *detune, q15_t (*wavegen)(q15_t input)) {
-    memset(node, 0, sizeof(SynthNode_t));
+void synthVoiceBend(SynthVoice_t *voice, int32_t cents) {
+    synthVoiceGlideTo(voice, midiToPhaseIncrCents(voice->note, cents) >> voice->oversample, voice->glideLeft);
+}
+
+int synthVoiceSetOversample(SynthVoice_t *voice, int shift) {
+    if (shift < 0 || shift > SYNTH_OVERSAMPLE_MAX) {
+        return -1;
+    }
+    if (shift && !voice->decimator) {
+        voice->decimator = synthArenaAlloc(voice->synth, sizeof(SynthDecimator_t));
+        if (!voice->decimator) {
+            return -1;
+        }
+    }
+    if (voice->decimator) {
+        memset(voice->decimator, 0, sizeof(SynthDecimator_t));
+    }
+    //keep playing the same pitch, however phaseIncrement was set
+    int from = voice->oversample;
+    voice->phaseIncrement = (SynthPhase_t) (((uint64_t) voice->phaseIncrement << from) >> shift);
+    if (voice->glideLeft) {
+        //and carry on gliding to the same pitch, over the same time
+        SynthPhase_t target = (SynthPhase_t) (((uint64_t) voice->glideTarget << from) >> shift);
+        uint32_t left = ((uint32_t) voice->glideLeft << shift) >> from;
+        synthVoiceGlideTo(voice, target, left < 0xFFFF ? left : 0xFFFF);
+    }
+    voice->oversample = shift;
+    return 0;
+}
+
+//a node has been wired up, so its voice has to redo its schedule before it next runs
+static void synthNodeRewired(SynthNode_t *node) {
+    if (node->voice) {
+        node->voice->rewired = 1;
+    }
+}
+
+void synthInitOscNode(SynthNode_t *node, q15_t *gain, SynthPhase_t *phaseIncrement, q15_t *detune, q15_t (*wavegen)(q15_t input)) {
+    synthNodeClear(node);
+    synthNodeRewired(node);
     node->gain = gain;
     node->type = SYNTH_NODE_OSCILLATOR;
     node->osc.phaseIncrement = phaseIncrement;
@@ -61,8 +290,30 @@ void synthInitOscNode(SynthNode_t *node, q15_t *gain, q15_t *phaseIncrement, q15
     node->osc.wavegen = wavegen;
 }
 
+void synthInitOscBlNode(SynthNode_t *node, q15_t *gain, SynthPhase_t *phaseIncrement, q15_t *detune, q15_t (*wavegen)(q15_t input, q15_t increment)) {
+    synthNodeClear(node);
+    synthNodeRewired(node);
+    node->gain = gain;
+    node->type = SYNTH_NODE_OSCILLATOR_BL;
+    node->osc.phaseIncrement = phaseIncrement;
+    node->osc.detune = detune;
+    node->osc.wavegenBl = wavegen;
+}
+
+void synthInitWavetableNode(SynthNode_t *node, q15_t *gain, SynthPhase_t *phaseIncrement, q15_t *detune, const SynthWavetable_t *table, q15_t *position) {
+    synthNodeClear(node);
+    synthNodeRewired(node);
+    node->gain = gain;
+    node->type = SYNTH_NODE_WAVETABLE;
+    node->osc.phaseIncrement = phaseIncrement;
+    node->osc.detune = detune;
+    node->osc.table = table;
+    node->osc.position = position;
+}
+
 void synthInitEnvelopeNode(SynthNode_t *node, q15_t *gain, q15_t attack, q15_t decay, q15_t sustain, q15_t release) {
-    memset(node, 0, sizeof(SynthNode_t));
+    synthNodeClear(node);
+    synthNodeRewired(node);
     node->gain = gain;
     node->type = SYNTH_NODE_ENVELOPE;
     node->env.attack = attack;
@@ -71,21 +322,24 @@ void synthInitEnvelopeNode(SynthNode_t *node, q15_t *gain, q15_t attack, q15_t d
     node->env.release = release;
 }
 void synthInitFilterLpNode(SynthNode_t *node, q15_t *gain, q15_t *input, q15_t factor) {
-    memset(node, 0, sizeof(SynthNode_t));
+    synthNodeClear(node);
+    synthNodeRewired(node);
     node->gain = gain;
     node->type = SYNTH_NODE_FILTER_LP;
     node->filter.input = input;
     node->filter.factor = factor;
 }
 void synthInitFilterHpNode(SynthNode_t *node, q15_t *gain, q15_t *input, q15_t factor) {
-    memset(node, 0, sizeof(SynthNode_t));
+    synthNodeClear(node);
+    synthNodeRewired(node);
     node->gain = gain;
     node->type = SYNTH_NODE_FILTER_HP;
     node->filter.input = input;
     node->filter.factor = factor;
 }
 void synthInitMixerNode(SynthNode_t *node, q15_t *gain, q15_t *input1, q15_t *input2, q15_t *input3) {
-    memset(node, 0, sizeof(SynthNode_t));
+    synthNodeClear(node);
+    synthNodeRewired(node);
     node->gain = gain;
     node->type = SYNTH_NODE_MIXER;
     node->mixer.inputs[0] = input1;
@@ -93,136 +347,1049 @@ void synthInitMixerNode(SynthNode_t *node, q15_t *gain, q15_t *input1, q15_t *in
     node->mixer.inputs[2] = input3;
 }
 
-q15_t synthProcess() {
-    int32_t mainOutput = 0;
-    for (int vi = 0; vi < SYNTH_VOICES; vi++) {
-        SynthVoice_t *voice = &synthVoices[vi];
-        SynthNode_t *nodes = voice->nodes;
-        //first pass, generate outputs from current state
-        int32_t outputs[SYNTH_NODES]; //store the outputs of each node during calc, then update after
-        for (int i = 0; i < SYNTH_NODES && nodes[i].type != SYNTH_NODE_NONE; i++) {
-            SynthNode_t *node = &nodes[i];
-            q15_t tmp;
-            switch (node->type) {
-                case SYNTH_NODE_OSCILLATOR:
-                    tmp = node->state & 0x7FFF; //mask to positive q15
-                    outputs[i] = node->osc.wavegen(tmp);
-                    break;
-                case SYNTH_NODE_ENVELOPE:
-                    outputs[i] = (node->state & 0x7FFFFF) >> 4;
-                    outputs[i] = (outputs[i] * outputs[i]) >> 15; //square the envelope
-                    //if sustain is negative, this is a negative envelope, so invert the output
-                    if (node->env.sustain < 0) {
-                        outputs[i] = -outputs[i];
-                    }
-                    break;
-                case SYNTH_NODE_FILTER_LP:
-                    outputs[i] = (node->filter.accum * node->filter.factor) >> 15;
-                    break;
-                case SYNTH_NODE_FILTER_HP:
-                    //same as lp, then subtract from input
-                    outputs[i] = (node->filter.accum * node->filter.factor) >> 15;
-                    outputs[i] = *node->filter.input - outputs[i];
-                    break;
-                case SYNTH_NODE_MIXER: {
-                    int32_t sum = 0;
-                    // tmp = 0;
-                    for (int j = 0; j < 3; j++) {
-                        if (node->mixer.inputs[j]) {
-                            sum += *node->mixer.inputs[j];
-                            // tmp++;
-                        }
-                    }
-                    //NOTE: this can be done in the gain setting, can avoid extra calc
-                    // if (tmp == 2) {
-                    //     sum >>= 1; //divide by 2 by shifting
-                    // } else if (tmp == 3) {
-                    //     sum = sum * 10922 >> 15; //divide by 3 by multiplying by 1/3 in q15
-                    // }
-                    outputs[i] = sum; 
-                    break;
+void synthInitFilterSvfNode(SynthNode_t *node, q15_t *gain, q15_t *input, q15_t *cutoff, q15_t *resonance, SynthSvfOutput_t mode) {
+    synthNodeClear(node);
+    synthNodeRewired(node);
+    node->gain = gain;
+    node->type = SYNTH_NODE_FILTER_SVF;
+    node->svf.input = input;
+    node->svf.cutoff = cutoff;
+    node->svf.resonance = resonance;
+    node->svf.mode = mode;
+}
+
+void synthInitNoiseNode(SynthNode_t *node, q15_t *gain, uint32_t seed) {
+    synthNodeClear(node);
+    synthNodeRewired(node);
+    node->gain = gain;
+    node->type = SYNTH_NODE_NOISE;
+    //xorshift would be stuck at 0
+    node->state = seed ? seed : SYNTH_NOISE_SEED;
+}
+
+int synthInitDelayNode(SynthNode_t *node, q15_t *gain, q15_t *input, q15_t *time, q15_t *feedback, SynthDelayPool_t *pool) {
+    //a node rewired with the same pool keeps its line
+    q15_t *line = NULL;
+    if (node->type == SYNTH_NODE_DELAY && node->delay.pool == pool) {
+        line = node->delay.line;
+        node->delay.line = NULL;
+    }
+    synthNodeClear(node);
+    synthNodeRewired(node);
+    node->gain = gain;
+    node->type = SYNTH_NODE_DELAY;
+    node->delay.input = input;
+    node->delay.time = time;
+    node->delay.feedback = feedback;
+    node->delay.pool = pool;
+    for (int k = 0; !line && k < pool->lineCount; k++) {
+        if (!(pool->used & (1UL << k))) {
+            pool->used |= 1UL << k;
+            line = pool->samples + k * pool->lineLength;
+        }
+    }
+    if (!line) {
+        return -1;
+    }
+    memset(line, 0, pool->lineLength * sizeof(q15_t));
+    node->delay.line = line;
+    node->delay.mask = pool->lineLength - 1;
+    return 0;
+}
+
+void synthNodeClear(SynthNode_t *node) {
+    if (node->type == SYNTH_NODE_DELAY && node->delay.line) {
+        SynthDelayPool_t *pool = node->delay.pool;
+        pool->used &= ~(1UL << ((node->delay.line - pool->samples) / pool->lineLength));
+    }
+    SynthVoice_t *voice = node->voice;
+    memset(node, 0, sizeof(SynthNode_t));
+    node->voice = voice;
+}
+
+void synthNodeSetRate(SynthNode_t *node, uint8_t rate) {
+    if (node->type != SYNTH_NODE_ENVELOPE && node->type != SYNTH_NODE_OSCILLATOR) {
+        rate = 0;
+    }
+    if (rate > SYNTH_CONTROL_RATE_MAX) {
+        rate = SYNTH_CONTROL_RATE_MAX;
+    }
+    node->rate = rate;
+    node->tick = 0;
+}
+
+void synthNodeSetRetrigger(SynthNode_t *node, SynthRetrigger_t retrigger) {
+    node->retrigger = retrigger;
+}
+
+//what a node input pointer refers to
+#define SYNTH_SOURCE_EXTERNAL -1 //not driven by the voice's nodes, e.g. voice->phaseIncrement or a global
+#define SYNTH_SOURCE_FOREIGN -2 //another voice, or some part of a node other than its outputs
+
+//which of a node's secondary outputs p is, or -1
+static int synthNodeTap(const SynthNode_t *node, const q15_t *p) {
+    if (node->type == SYNTH_NODE_FILTER_SVF && p >= node->svf.outputs && p < node->svf.outputs + 4) {
+        return p - node->svf.outputs;
+    }
+    return -1;
+}
+
+//nodes of other instances are in another arena, so they count as external
+static int synthNodeSource(SynthVoice_t *voice, const q15_t *p) {
+    uintptr_t addr = (uintptr_t) p;
+    uintptr_t arenaStart = (uintptr_t) voice->synth->arena;
+    if (addr < arenaStart || addr >= arenaStart + voice->synth->arenaUsed) {
+        return SYNTH_SOURCE_EXTERNAL;
+    }
+    uintptr_t nodesStart = (uintptr_t) voice->nodes;
+    if (addr >= nodesStart && addr < nodesStart + voice->nodeCapacity * sizeof(SynthNode_t)) {
+        int j = (addr - nodesStart) / sizeof(SynthNode_t);
+        if (p != &voice->nodes[j].output && synthNodeTap(&voice->nodes[j], p) < 0) {
+            return SYNTH_SOURCE_FOREIGN;
+        }
+        //nodes past the end of the chain never run, so their output can't change
+        return j < voice->nodeCount ? j : SYNTH_SOURCE_EXTERNAL;
+    }
+    if ((addr >= (uintptr_t) voice && addr < (uintptr_t) (voice + 1))
+            || (addr >= (uintptr_t) voice->params && addr < (uintptr_t) (voice->params + voice->paramCount))) {
+        return SYNTH_SOURCE_EXTERNAL;
+    }
+    return SYNTH_SOURCE_FOREIGN;
+}
+
+//collect the inputs a node reads
+static int synthNodeInputs(const SynthNode_t *node, q15_t **inputs) {
+    int count = 0;
+    if (node->gain) {
+        inputs[count++] = node->gain;
+    }
+    switch (node->type) {
+        case SYNTH_NODE_OSCILLATOR:
+        case SYNTH_NODE_OSCILLATOR_BL:
+        case SYNTH_NODE_WAVETABLE:
+            inputs[count++] = (q15_t *) node->osc.phaseIncrement;
+            if (node->osc.detune) {
+                inputs[count++] = node->osc.detune;
+            }
+            if (node->type == SYNTH_NODE_WAVETABLE && node->osc.position) {
+                inputs[count++] = node->osc.position;
+            }
+            break;
+        case SYNTH_NODE_FILTER_LP:
+        case SYNTH_NODE_FILTER_HP:
+            inputs[count++] = node->filter.input;
+            break;
+        case SYNTH_NODE_MIXER:
+            for (int j = 0; j < 3; j++) {
+                if (node->mixer.inputs[j]) {
+                    inputs[count++] = node->mixer.inputs[j];
                 }
-                default:
-                    break;
             }
+            break;
+        case SYNTH_NODE_FILTER_SVF:
+            inputs[count++] = node->svf.input;
+            inputs[count++] = node->svf.cutoff;
+            if (node->svf.resonance) {
+                inputs[count++] = node->svf.resonance;
+            }
+            break;
+        case SYNTH_NODE_DELAY:
+            if (node->delay.input) {
+                inputs[count++] = node->delay.input;
+            }
+            if (node->delay.time) {
+                inputs[count++] = node->delay.time;
+            }
+            if (node->delay.feedback) {
+                inputs[count++] = node->delay.feedback;
+            }
+            break;
+        default:
+            break;
+    }
+    return count;
+}
 
-            if (node->gain) {
-                //TODO for now, just linear gain
-                //positive gain should amplify the signal, while negative gain should attenuate the signal
-                //but also need to pair well with envelop generators
-                outputs[i] = (outputs[i] * *node->gain) >> 15;
+//give a secondary output a block buffer, if it doesn't have one yet
+static void synthVoiceAddTap(SynthVoice_t *voice, uint8_t tap) {
+    for (int k = 0; k < voice->tapCount; k++) {
+        if (voice->taps[k] == tap) {
+            return;
+        }
+    }
+    if (voice->tapCount < SYNTH_TAPS) {
+        voice->taps[voice->tapCount++] = tap;
+    } else {
+        voice->tapOverflow = 1;
+    }
+}
+
+void synthVoiceSchedule(SynthVoice_t *voice) {
+    int nodeCount = 0;
+    while (nodeCount < voice->nodeCapacity && voice->nodes[nodeCount].type != SYNTH_NODE_NONE) {
+        nodeCount++;
+    }
+    voice->nodeCount = nodeCount;
+    voice->feedback = 0;
+    voice->linked = 0;
+    voice->tapOverflow = 0;
+    voice->tapCount = 0;
+
+    //find which nodes each node reads from
+    uint32_t deps[SYNTH_NODES];
+    for (int i = 0; i < nodeCount; i++) {
+        q15_t *inputs[5];
+        int count = synthNodeInputs(&voice->nodes[i], inputs);
+        deps[i] = 0;
+        for (int k = 0; k < count; k++) {
+            int j = synthNodeSource(voice, inputs[k]);
+            if (j == SYNTH_SOURCE_FOREIGN) {
+                voice->linked = 1;
+            } else if (j >= 0 && j != i) { //a node reading itself is fine, it sees its previous output
+                deps[i] |= 1UL << j;
+            }
+            if (j >= 0 && inputs[k] != &voice->nodes[j].output) {
+                synthVoiceAddTap(voice, j << 2 | synthNodeTap(&voice->nodes[j], inputs[k]));
             }
         }
+    }
 
-        //second pass, update state
-        for (int i = 0; i < SYNTH_NODES && nodes[i].type != SYNTH_NODE_NONE; i++) {
-            SynthNode_t *node = &nodes[i];
-            node->output = outputs[i];
-            switch (node->type) {
-                case SYNTH_NODE_OSCILLATOR:
-                    //add in the phase increment and detune
-                    node->state += *node->osc.phaseIncrement;
-                    if (node->osc.detune) {
-                        node->state += *node->osc.detune;
-                    }
-                    //TODO is this needed? would negative increments and state be OK if we mask it before wavegen?
-                    node->state &= 0x7FFF; //wrap around q15
-                    break;
-                case SYNTH_NODE_ENVELOPE:
-                    //the top bit of state is reserved for the decay mode (after attack)
-                    if (voice->gate) { //while gate is on, do attack, then decay
-                        int modeBit = node->state & 0x80000000;
-                        int32_t value = node->state & 0x7FFFFFFF;
-                        if (modeBit) {
-                            //decay
-                            value -= node->env.decay;
-                            const q15_t sustainAbs = node->env.sustain < 0 ? -node->env.sustain : node->env.sustain;
-                            if (value < sustainAbs << 4) {
-                                value = sustainAbs << 4;
-                            }
-                        } else {
-                            //attack
-                            value += node->env.attack;
-                            if (value > (int32_t)Q15_MAX << 4) {
-                                value = (int32_t)Q15_MAX << 4;
-                                modeBit = 0x80000000; //switch to decay
-                            }
-                        }
-                        node->state = value | modeBit;
-                    } else { //when gate is off, do release
-                        //clear the modeBit (if set), so the next gate on will start with attack
-                        node->state &= 0x7FFFFFFF;
-                        node->state -= node->env.release;
-                        if (node->state < 0) {
-                            node->state = 0;
-                        }
-                    }
-                    break;
-                case SYNTH_NODE_FILTER_LP:
-                    node->filter.accum += (*node->filter.input - node->output);
-                    break;
-                case SYNTH_NODE_FILTER_HP:
-                    node->filter.accum += (*node->filter.input - node->output);
-                    break;
-                case SYNTH_NODE_MIXER:
-                    break;
-                default:
-                    break;
+    //run every node after the nodes it reads from
+    uint32_t done = 0;
+    for (int n = 0; n < nodeCount; n++) {
+        int next = -1;
+        for (int i = 0; i < nodeCount; i++) {
+            if (!(done & (1UL << i)) && (deps[i] & ~done) == 0) {
+                next = i;
+                break;
             }
         }
+        if (next < 0) {
+            //feedback loop. break it at the first remaining node, which will see the previous sample's
+            //output of the nodes in the loop that haven't run yet
+            for (next = 0; done & (1UL << next); next++)
+                ;
+            voice->feedback = 1;
+        }
+        voice->order[n] = next;
+        done |= 1UL << next;
+    }
+    voice->rewired = 0;
+}
 
-        //add the output of the voice to the main output
-        mainOutput += voice->nodes[0].output;
+//control rate nodes work out where they will be in 1 << rate samples, stepping their state that many samples at once,
+//then ramp their output there. inc and detune are only used for oscillators
+static inline void synthControlUpdate(SynthVoice_t *voice, SynthNode_t *node, const q15_t *gain, const SynthPhase_t *inc, const q15_t *detune) {
+    int rate = node->rate;
+    int32_t target;
+    if (node->type == SYNTH_NODE_ENVELOPE) {
+        target = synthEnvelopeOutput(node->state, node->env.sustain);
+        node->state = synthEnvelopeStep(node->state, voice->gate, node->env.attack << rate, node->env.decay << rate,
+                node->env.sustain, node->env.release << rate);
+    } else {
+        target = node->osc.wavegen(synthPhaseWave(node->state));
+        node->state = synthPhaseStep(node->state, *inc << rate, detune ? *detune * (1 << rate) : 0);
+    }
+    if (gain) {
+        target = (target * *gain) >> 15;
+    }
+    node->rampFrom = node->output;
+    node->rampTo = target;
+}
+
+//k samples into the ramp, reaches rampTo at k = 1 << rate
+static inline q15_t synthControlRamp(const SynthNode_t *node, int k) {
+    return node->rampFrom + (((node->rampTo - node->rampFrom) * k) >> node->rate);
+}
+
+static inline void synthNodeProcess(SynthVoice_t *voice, SynthNode_t *node) {
+    if (node->rate) {
+        if (node->tick == 0) {
+            int osc = node->type == SYNTH_NODE_OSCILLATOR;
+            synthControlUpdate(voice, node, node->gain, osc ? node->osc.phaseIncrement : NULL, osc ? node->osc.detune : NULL);
+        }
+        node->tick++;
+        node->output = synthControlRamp(node, node->tick);
+        node->tick &= (1 << node->rate) - 1;
+        return;
+    }
+    //generate output from current state
+    int32_t output;
+    switch (node->type) {
+        case SYNTH_NODE_OSCILLATOR:
+            output = node->osc.wavegen(synthPhaseWave(node->state));
+            break;
+        case SYNTH_NODE_OSCILLATOR_BL: {
+            q15_t increment = synthPhaseIncrement15(*node->osc.phaseIncrement) + (node->osc.detune ? *node->osc.detune : 0);
+            output = node->osc.wavegenBl(synthPhaseWave(node->state), increment);
+            break;
+        }
+        case SYNTH_NODE_WAVETABLE:
+            output = synthWavetableLookup(node->osc.table, synthPhaseWave(node->state), node->osc.position ? *node->osc.position : 0);
+            break;
+        case SYNTH_NODE_ENVELOPE:
+            output = synthEnvelopeOutput(node->state, node->env.sustain);
+            break;
+        case SYNTH_NODE_FILTER_LP:
+            output = (node->filter.accum * node->filter.factor) >> 15;
+            break;
+        case SYNTH_NODE_FILTER_HP:
+            //same as lp, then subtract from input
+            output = (node->filter.accum * node->filter.factor) >> 15;
+            output = *node->filter.input - output;
+            break;
+        case SYNTH_NODE_FILTER_SVF: {
+            //runs on this sample's input, and keeps every response for nodes reading the secondary outputs
+            int32_t outputs[4];
+            synthSvfStep(&node->svf.low, &node->svf.band, *node->svf.input, synthSvfCutoff(*node->svf.cutoff),
+                    synthSvfDamping(node->svf.resonance ? *node->svf.resonance : 0), outputs);
+            for (int k = 0; k < 4; k++) {
+                int32_t value = synthClampQ15(outputs[k]);
+                node->svf.outputs[k] = node->gain ? (value * *node->gain) >> 15 : value;
+            }
+            output = synthClampQ15(outputs[node->svf.mode]);
+            break;
+        }
+        case SYNTH_NODE_MIXER: {
+            int32_t sum = 0;
+            for (int j = 0; j < 3; j++) {
+                if (node->mixer.inputs[j]) {
+                    sum += *node->mixer.inputs[j];
+                }
+            }
+            //NOTE: any scaling for the number of inputs can be done in the gain setting, avoids extra calc
+            output = sum;
+            break;
+        }
+        case SYNTH_NODE_NOISE:
+            output = synthNoiseOutput(node->state);
+            break;
+        case SYNTH_NODE_DELAY:
+            //reads and writes the line in one go, so reading its own output as input sees the previous one
+            output = 0;
+            if (node->delay.line) {
+                output = synthDelayStep(&node->delay, &node->state, node->delay.input ? *node->delay.input : 0,
+                        node->delay.time ? *node->delay.time : 0, node->delay.feedback ? *node->delay.feedback : 0);
+            }
+            break;
+        default:
+            output = 0;
+            break;
+    }
+
+    if (node->gain) {
+        //TODO for now, just linear gain
+        //positive gain should amplify the signal, while negative gain should attenuate the signal
+        //but also need to pair well with envelop generators
+        output = (output * *node->gain) >> 15;
+    }
+    node->output = output;
+
+    //update state
+    switch (node->type) {
+        case SYNTH_NODE_OSCILLATOR:
+        case SYNTH_NODE_OSCILLATOR_BL:
+        case SYNTH_NODE_WAVETABLE:
+            //add in the phase increment and detune, wrapping around
+            node->state = synthPhaseStep(node->state, *node->osc.phaseIncrement, node->osc.detune ? *node->osc.detune : 0);
+            break;
+        case SYNTH_NODE_ENVELOPE:
+            node->state = synthEnvelopeStep(node->state, voice->gate, node->env.attack, node->env.decay, node->env.sustain, node->env.release);
+            break;
+        case SYNTH_NODE_FILTER_LP:
+        case SYNTH_NODE_FILTER_HP:
+            node->filter.accum += (*node->filter.input - node->output);
+            break;
+        case SYNTH_NODE_NOISE:
+            node->state = synthNoiseStep(node->state);
+            break;
+        default:
+            break;
+    }
+}
+
+//halfband coefficient pairs from the center out, designed for the least error over the stopband. the last stage's
+//pass up to 0.2 of its input rate and stop from 0.3, the 4x stage only has to stop what would fold into the final
+//passband, from 0.4
+static const q15_t synthHalfbandLast[SYNTH_HALFBAND_TAPS] = {10344, -3225, 1688, -976, 564, -309, 152, -69};
+static const q15_t synthHalfbandFirst[3] = {9784, -1905, 318};
+
+//one output of a halfband stage with taps coefficient pairs, from the next even and odd input samples
+static inline q15_t synthHalfbandStep(SynthHalfband_t *stage, const q15_t *coefs, int taps, q15_t even, q15_t odd) {
+    int span = 2 * taps;
+    int pos = stage->pos ? stage->pos - 1 : span - 1;
+    stage->pos = pos;
+    stage->even[pos] = stage->even[pos + span] = even;
+    const q15_t *e = &stage->even[pos];
+    //the center tap is half, on the odd sample from taps pairs back
+    int32_t acc = (int32_t) stage->odd[stage->oddPos] << 14;
+    stage->odd[stage->oddPos] = odd;
+    stage->oddPos = stage->oddPos + 1 < taps ? stage->oddPos + 1 : 0;
+    for (int i = 0; i < taps; i++) {
+        acc += coefs[i] * (e[taps - 1 - i] + e[taps + i]);
+    }
+    return synthClampQ15((acc + (1 << 14)) >> 15);
+}
+
+//one output sample from 1 << shift samples at the voice's oversampled rate
+static inline int32_t synthDecimate(SynthDecimator_t *decimator, int shift, const q15_t *in) {
+    q15_t even = in[0];
+    q15_t odd = in[1];
+    if (shift == 2) {
+        even = synthHalfbandStep(&decimator->stages[1], synthHalfbandFirst, 3, in[0], in[1]);
+        odd = synthHalfbandStep(&decimator->stages[1], synthHalfbandFirst, 3, in[2], in[3]);
+    }
+    return synthHalfbandStep(&decimator->stages[0], synthHalfbandLast, SYNTH_HALFBAND_TAPS, even, odd);
+}
+
+//nothing left in the decimators' history to come out
+static int synthDecimatorQuiet(const SynthVoice_t *voice) {
+    for (int k = 0; k < voice->oversample; k++) {
+        const SynthHalfband_t *stage = &voice->decimator->stages[k];
+        for (int i = 0; i < 2 * SYNTH_HALFBAND_TAPS; i++) {
+            if (stage->even[i] || (i < SYNTH_HALFBAND_TAPS && stage->odd[i])) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static inline void synthVoiceCheckSchedule(SynthVoice_t *voice) {
+    if (voice->rewired) {
+        synthVoiceSchedule(voice);
+    }
+}
+
+//run the voice's nodes for one sample at its own rate and return its output
+static int32_t synthProcessVoiceStep(SynthVoice_t *voice) {
+    synthVoiceGlideStep(voice);
+    //nodes run in dependency order, so each one sees this sample's output of the nodes it reads
+    for (int k = 0; k < voice->nodeCount; k++) {
+        SynthNode_t *node = &voice->nodes[voice->order[k]];
+        SYNTH_PROFILE_RUN(node->type, 1, synthNodeProcess(voice, node));
+    }
+    return voice->nodes[voice->outputNode].output;
+}
+
+//run one sample of a voice and return its output
+static int32_t synthProcessVoice(SynthVoice_t *voice) {
+    if (voice->oversample) {
+        q15_t samples[1 << SYNTH_OVERSAMPLE_MAX];
+        for (int k = 0; k < 1 << voice->oversample; k++) {
+            samples[k] = synthProcessVoiceStep(voice);
+        }
+        return synthDecimate(voice->decimator, voice->oversample, samples);
     }
+    return synthProcessVoiceStep(voice);
+}
 
-#if SYNTH_VOICES > 1
-    const q15_t mainMixerGain = Q15_MAX / SYNTH_VOICES;
-    return (mainOutput * mainMixerGain) >> 15;
+static inline q15_t synthMainMix(const Synth_t *synth, int32_t mainOutput) {
+#if SYNTH_SOFT_MASTER
+    (void) synth;
+    return softClipperInline(mainOutput);
 #else
+    //a single voice can't clip, so it passes straight through
+    if (synth->voiceCount > 1) {
+        return (mainOutput * synth->mixGain) >> 15;
+    }
     return mainOutput;
 #endif
 }
 
+void synthVoiceCheckIdle(SynthVoice_t *voice) {
+    synthVoiceCheckSchedule(voice);
+    //only voices with envelopes can tell when they are done, and only once the gate is off and it has gone quiet
+    if (voice->gate || voice->nodeCount == 0 || voice->nodes[voice->outputNode].output != 0) {
+        return;
+    }
+    if (voice->oversample && !synthDecimatorQuiet(voice)) {
+        return;
+    }
+    int envelopes = 0;
+    for (int i = 0; i < voice->nodeCount; i++) {
+        SynthNode_t *node = &voice->nodes[i];
+        if (node->type == SYNTH_NODE_ENVELOPE) {
+            //a control rate envelope can still be ramping down after its state reaches 0
+            if (node->state != 0 || node->output != 0) {
+                return;
+            }
+            envelopes++;
+        } else if (node->type == SYNTH_NODE_DELAY && node->delay.line && (uint32_t) node->state <= node->delay.mask) {
+            //there's still something in the line to come out
+            return;
+        }
+    }
+    voice->idle = envelopes > 0;
+}
+
+int synthActiveVoices(Synth_t *synth) {
+    int count = 0;
+    for (int vi = 0; vi < synth->voiceCount; vi++) {
+        if (!synth->voices[vi].idle && synth->voices[vi].nodeCount) {
+            count++;
+        }
+    }
+    return count;
+}
+
+q15_t synthHeadroom(Synth_t *synth) {
+    for (int vi = 0; vi < synth->voiceCount; vi++) {
+        synth->nodesRun -= synth->voices[vi].nodesSkipped;
+        synth->voices[vi].nodesSkipped = 0;
+    }
+    q15_t res = Q15_MAX;
+    if (synth->nodesTotal) {
+        res = ((uint64_t) (synth->nodesTotal - synth->nodesRun) * Q15_MAX) / synth->nodesTotal;
+    }
+    synth->nodesRun = 0;
+    synth->nodesTotal = 0;
+    return res;
+}
+
+//run the next sample of a voice for synthProcess, 0 if it's idle
+static inline int32_t synthProcessVoiceSample(Synth_t *synth, SynthVoice_t *voice) {
+    synthVoiceCheckSchedule(voice);
+    synth->nodesTotal += voice->nodeCount << voice->oversample;
+    if (voice->idle || voice->nodeCount == 0) {
+        return 0;
+    }
+    synth->nodesRun += voice->nodeCount << voice->oversample;
+    int32_t output = synthProcessVoice(voice);
+    if (!voice->gate) {
+        synthVoiceCheckIdle(voice);
+    }
+    return output;
+}
+
+q15_t synthProcess(Synth_t *synth) {
+    int32_t mainOutput = 0;
+    for (int vi = 0; vi < synth->voiceCount; vi++) {
+        //add the output of the voice to the main output
+        mainOutput += synthProcessVoiceSample(synth, &synth->voices[vi]);
+    }
+    return synthMainMix(synth, mainOutput);
+}
+
+void synthMixdown(Synth_t *synth, const int32_t *mix, q15_t *out, size_t n) {
+    for (size_t t = 0; t < n; t++) {
+        out[t] = synthMainMix(synth, mix[t]);
+    }
+}
+
+
+//block processing runs each node over the whole block before moving on to the next node, in schedule order.
+//every node gets a scratch buffer with its previous output in [0] followed by the block's outputs,
+//so a node reading another node's output can walk that buffer.
+//the instance's scratch is taken from its arena the first time, without room for it everything runs a sample at a time
+static SynthBlockScratch_t *synthBlockScratch(Synth_t *synth) {
+    if (!synth->scratch) {
+        synth->scratch = synthArenaAlloc(synth, sizeof(SynthBlockScratch_t));
+    }
+    return synth->scratch;
+}
+
+//a node input while processing a block. step is 0 for held values, 1 to walk a node's buffer
+typedef struct SynthBlockInput {
+    const q15_t *ptr;
+    int step;
+} SynthBlockInput_t;
+
+//late inputs are read while updating state, after the node's own output for the sample is known
+static SynthBlockInput_t synthBlockInput(SynthVoice_t *voice, SynthBlockScratch_t *scratch, int reader, const q15_t *p, int late) {
+    SynthBlockInput_t in = {p, 0};
+    int j = synthNodeSource(voice, p);
+    if (j >= 0) {
+        //other nodes already ran for the whole block. a node reading its own output sees the previous one
+        const q15_t *buffer = scratch->buffers[j];
+        if (p != &voice->nodes[j].output) {
+            //a secondary output, find its buffer
+            uint8_t tap = j << 2 | synthNodeTap(&voice->nodes[j], p);
+            for (int k = 0; k < voice->tapCount; k++) {
+                if (voice->taps[k] == tap) {
+                    buffer = scratch->taps[k];
+                }
+            }
+        }
+        in.ptr = &buffer[(j != reader || late) ? 1 : 0];
+        in.step = 1;
+    }
+    return in;
+}
+
+//a phase increment input. with SYNTH_PHASE_32 increments can't be node outputs, so they are held for the block
+typedef struct SynthPhaseInput {
+    const SynthPhase_t *ptr;
+    int step;
+} SynthPhaseInput_t;
+
+static SynthPhaseInput_t synthBlockPhaseInput(SynthVoice_t *voice, SynthBlockScratch_t *scratch, int reader, const SynthPhase_t *p, int late) {
+#if SYNTH_PHASE_32
+    (void) voice;
+    (void) scratch;
+    (void) reader;
+    (void) late;
+    SynthPhaseInput_t in = {p, 0};
+#else
+    SynthBlockInput_t input = synthBlockInput(voice, scratch, reader, p, late);
+    SynthPhaseInput_t in = {input.ptr, input.step};
+#endif
+    return in;
+}
+
+static void synthBlockNode(SynthVoice_t *voice, SynthBlockScratch_t *scratch, int i, int n) {
+    SynthNode_t *node = &voice->nodes[i];
+    q15_t *out = &scratch->buffers[i][1];
+    SynthBlockInput_t gain = {NULL, 0};
+    if (node->gain) {
+        gain = synthBlockInput(voice, scratch, i, node->gain, 0);
+    }
+    if (node->rate) {
+        SynthPhaseInput_t inc = {NULL, 0};
+        SynthBlockInput_t detune = {NULL, 0};
+        if (node->type == SYNTH_NODE_OSCILLATOR) {
+            inc = synthBlockPhaseInput(voice, scratch, i, node->osc.phaseIncrement, 0);
+            if (node->osc.detune) {
+                detune = synthBlockInput(voice, scratch, i, node->osc.detune, 0);
+            }
+        }
+        //a ramp at a time
+        int period = 1 << node->rate;
+        for (int t = 0; t < n;) {
+            if (node->tick == 0) {
+                synthControlUpdate(voice, node, gain.ptr ? gain.ptr + t * gain.step : NULL,
+                        inc.ptr ? inc.ptr + t * inc.step : NULL, detune.ptr ? detune.ptr + t * detune.step : NULL);
+            }
+            int count = period - node->tick;
+            if (count > n - t) {
+                count = n - t;
+            }
+            int32_t from = node->rampFrom;
+            int32_t delta = node->rampTo - from;
+            int rate = node->rate;
+            for (int k = node->tick + 1; k <= node->tick + count; k++) {
+                out[t++] = from + ((delta * k) >> rate);
+            }
+            node->tick = (node->tick + count) & (period - 1);
+            node->output = out[t - 1];
+        }
+        return;
+    }
+    int32_t value;
+    switch (node->type) {
+        case SYNTH_NODE_OSCILLATOR:
+        case SYNTH_NODE_OSCILLATOR_BL:
+        case SYNTH_NODE_WAVETABLE: {
+            SynthPhaseInput_t inc = synthBlockPhaseInput(voice, scratch, i, node->osc.phaseIncrement, 1);
+            SynthBlockInput_t detune = {NULL, 0};
+            if (node->osc.detune) {
+                detune = synthBlockInput(voice, scratch, i, node->osc.detune, 1);
+            }
+            int bandLimited = node->type == SYNTH_NODE_OSCILLATOR_BL;
+            int wavetable = node->type == SYNTH_NODE_WAVETABLE;
+            SynthBlockInput_t position = {NULL, 0};
+            if (wavetable && node->osc.position) {
+                position = synthBlockInput(voice, scratch, i, node->osc.position, 0);
+            }
+            int32_t state = node->state;
+            const q15_t *self = &node->output;
+            if (node->gain != self && (const q15_t *) node->osc.phaseIncrement != self && node->osc.detune != self
+                    && (!wavetable || node->osc.position != self)) {
+                //work out the phases first, then the waveform and gain can run as block kernels
+                q15_t *phase = scratch->phase;
+                q15_t *increment = scratch->increment;
+                for (int t = 0; t < n; t++) {
+                    phase[t] = synthPhaseWave(state);
+                    SynthPhase_t step = *inc.ptr;
+                    inc.ptr += inc.step;
+                    int32_t fm = 0;
+                    if (detune.ptr) {
+                        fm = *detune.ptr;
+                        detune.ptr += detune.step;
+                    }
+                    increment[t] = synthPhaseIncrement15(step) + fm;
+                    state = synthPhaseStep(state, step, fm);
+                }
+                if (bandLimited) {
+                    for (int t = 0; t < n; t++) {
+                        out[t] = node->osc.wavegenBl(phase[t], increment[t]);
+                    }
+                } else if (wavetable) {
+                    //a copy, so the bank doesn't have to be read again after every store to out
+                    const SynthWavetable_t table = *node->osc.table;
+                    for (int t = 0; t < n; t++) {
+                        out[t] = synthWavetableLookup(&table, phase[t], position.ptr ? position.ptr[t * position.step] : 0);
+                    }
+                } else if (!synthWaveBlock(node->osc.wavegen, phase, out, n)) {
+                    for (int t = 0; t < n; t++) {
+                        out[t] = node->osc.wavegen(phase[t]);
+                    }
+                }
+                if (gain.ptr) {
+                    synthGainBlock(out, gain.ptr, gain.step, n);
+                }
+                node->state = state;
+                break;
+            }
+            //reads its own output, run a sample at a time.
+            //band limited wavegens get the increment as it was before this sample's output
+            SynthPhaseInput_t incNow = synthBlockPhaseInput(voice, scratch, i, node->osc.phaseIncrement, 0);
+            SynthBlockInput_t detuneNow = {NULL, 0};
+            if (node->osc.detune) {
+                detuneNow = synthBlockInput(voice, scratch, i, node->osc.detune, 0);
+            }
+            for (int t = 0; t < n; t++) {
+                if (bandLimited) {
+                    q15_t increment = synthPhaseIncrement15(*incNow.ptr);
+                    incNow.ptr += incNow.step;
+                    if (detuneNow.ptr) {
+                        increment += *detuneNow.ptr;
+                        detuneNow.ptr += detuneNow.step;
+                    }
+                    value = node->osc.wavegenBl(synthPhaseWave(state), increment);
+                } else if (wavetable) {
+                    q15_t at = 0;
+                    if (position.ptr) {
+                        at = *position.ptr;
+                        position.ptr += position.step;
+                    }
+                    value = synthWavetableLookup(node->osc.table, synthPhaseWave(state), at);
+                } else {
+                    value = node->osc.wavegen(synthPhaseWave(state));
+                }
+                if (gain.ptr) {
+                    value = (value * *gain.ptr) >> 15;
+                    gain.ptr += gain.step;
+                }
+                out[t] = value;
+                SynthPhase_t step = *inc.ptr;
+                inc.ptr += inc.step;
+                int32_t fm = 0;
+                if (detune.ptr) {
+                    fm = *detune.ptr;
+                    detune.ptr += detune.step;
+                }
+                state = synthPhaseStep(state, step, fm);
+            }
+            node->state = state;
+            break;
+        }
+        case SYNTH_NODE_ENVELOPE:
+            for (int t = 0; t < n; t++) {
+                value = synthEnvelopeOutput(node->state, node->env.sustain);
+                if (gain.ptr) {
+                    value = (value * *gain.ptr) >> 15;
+                    gain.ptr += gain.step;
+                }
+                out[t] = value;
+                node->state = synthEnvelopeStep(node->state, voice->gate, node->env.attack, node->env.decay, node->env.sustain, node->env.release);
+            }
+            break;
+        case SYNTH_NODE_FILTER_LP:
+        case SYNTH_NODE_FILTER_HP: {
+            SynthBlockInput_t input = synthBlockInput(voice, scratch, i, node->filter.input, 0);
+            SynthBlockInput_t update = synthBlockInput(voice, scratch, i, node->filter.input, 1);
+            int highPass = node->type == SYNTH_NODE_FILTER_HP;
+            int32_t accum = node->filter.accum;
+            int32_t factor = node->filter.factor;
+            for (int t = 0; t < n; t++) {
+                value = (accum * factor) >> 15;
+                if (highPass) {
+                    value = *input.ptr - value;
+                }
+                input.ptr += input.step;
+                if (gain.ptr) {
+                    value = (value * *gain.ptr) >> 15;
+                    gain.ptr += gain.step;
+                }
+                out[t] = value;
+                accum += *update.ptr - out[t];
+                update.ptr += update.step;
+            }
+            node->filter.accum = accum;
+            break;
+        }
+        case SYNTH_NODE_FILTER_SVF: {
+            SynthBlockInput_t input = synthBlockInput(voice, scratch, i, node->svf.input, 0);
+            SynthBlockInput_t cutoff = synthBlockInput(voice, scratch, i, node->svf.cutoff, 0);
+            SynthBlockInput_t resonance = {NULL, 0};
+            if (node->svf.resonance) {
+                resonance = synthBlockInput(voice, scratch, i, node->svf.resonance, 0);
+            }
+            //only the mode's response and the ones other nodes read are needed per sample
+            q15_t *taps[4] = {NULL, NULL, NULL, NULL};
+            for (int k = 0; k < voice->tapCount; k++) {
+                if (voice->taps[k] >> 2 == i) {
+                    taps[voice->taps[k] & 3] = &scratch->taps[k][1];
+                }
+            }
+            int mode = node->svf.mode;
+            int32_t low = node->svf.low;
+            int32_t band = node->svf.band;
+            int32_t f = synthSvfCutoff(*cutoff.ptr);
+            int32_t damping = synthSvfDamping(resonance.ptr ? *resonance.ptr : 0);
+            int32_t outputs[4];
+            for (int t = 0; t < n; t++) {
+                if (cutoff.step) {
+                    f = synthSvfCutoff(cutoff.ptr[t]);
+                }
+                if (resonance.step) {
+                    damping = synthSvfDamping(resonance.ptr[t]);
+                }
+                synthSvfStep(&low, &band, input.ptr[t * input.step], f, damping, outputs);
+                int32_t g = gain.ptr ? gain.ptr[t * gain.step] : 0;
+                value = synthClampQ15(outputs[mode]);
+                out[t] = gain.ptr ? (value * g) >> 15 : value;
+                for (int k = 0; k < 4; k++) {
+                    if (taps[k]) {
+                        value = synthClampQ15(outputs[k]);
+                        taps[k][t] = gain.ptr ? (value * g) >> 15 : value;
+                    }
+                }
+            }
+            //the last sample's responses, for reading between blocks and synthProcess
+            for (int k = 0; k < 4; k++) {
+                value = synthClampQ15(outputs[k]);
+                node->svf.outputs[k] = gain.ptr ? (value * gain.ptr[(n - 1) * gain.step]) >> 15 : value;
+            }
+            node->svf.low = low;
+            node->svf.band = band;
+            break;
+        }
+        case SYNTH_NODE_MIXER: {
+            const q15_t *inputs[3];
+            int steps[3];
+            for (int j = 0; j < 3; j++) {
+                inputs[j] = NULL;
+                steps[j] = 0;
+                if (node->mixer.inputs[j]) {
+                    SynthBlockInput_t input = synthBlockInput(voice, scratch, i, node->mixer.inputs[j], 0);
+                    inputs[j] = input.ptr;
+                    steps[j] = input.step;
+                }
+            }
+            synthMixBlock(out, inputs, steps, gain.ptr, gain.step, n);
+            break;
+        }
+        case SYNTH_NODE_DELAY: {
+            SynthBlockInput_t input = {NULL, 0}, time = {NULL, 0}, feedback = {NULL, 0};
+            if (node->delay.input) {
+                input = synthBlockInput(voice, scratch, i, node->delay.input, 0);
+            }
+            if (node->delay.time) {
+                time = synthBlockInput(voice, scratch, i, node->delay.time, 0);
+            }
+            if (node->delay.feedback) {
+                feedback = synthBlockInput(voice, scratch, i, node->delay.feedback, 0);
+            }
+            if (!node->delay.line) {
+                memset(out, 0, n * sizeof(q15_t));
+                break;
+            }
+            SynthDelay_t delay = node->delay;
+            int32_t quiet = node->state;
+            for (int t = 0; t < n; t++) {
+                value = synthDelayStep(&delay, &quiet, input.ptr ? input.ptr[t * input.step] : 0,
+                        time.ptr ? time.ptr[t * time.step] : 0, feedback.ptr ? feedback.ptr[t * feedback.step] : 0);
+                if (gain.ptr) {
+                    value = (value * gain.ptr[t * gain.step]) >> 15;
+                }
+                out[t] = value;
+            }
+            node->delay.pos = delay.pos;
+            node->state = quiet;
+            break;
+        }
+        case SYNTH_NODE_NOISE:
+            node->state = synthNoiseBlock(node->state, out, n);
+            if (gain.ptr && node->gain != &node->output) {
+                synthGainBlock(out, gain.ptr, gain.step, n);
+            } else if (gain.ptr) {
+                //its own output as gain, which has to be the gained output of the sample before
+                for (int t = 0; t < n; t++) {
+                    out[t] = (out[t] * out[t - 1]) >> 15;
+                }
+            }
+            break;
+        default:
+            for (int t = 0; t < n; t++) {
+                out[t] = 0;
+            }
+            break;
+    }
+}
+
+//run the voice's nodes over n samples at its own rate, returning its output buffer
+static const q15_t *synthVoiceRunBlock(SynthVoice_t *voice, SynthBlockScratch_t *scratch, int n) {
+    int nodeCount = voice->nodeCount;
+    for (int i = 0; i < nodeCount; i++) {
+        scratch->buffers[i][0] = voice->nodes[i].output;
+    }
+    for (int k = 0; k < voice->tapCount; k++) {
+        scratch->taps[k][0] = voice->nodes[voice->taps[k] >> 2].svf.outputs[voice->taps[k] & 3];
+    }
+    for (int k = 0; k < nodeCount; k++) {
+        int i = voice->order[k];
+        SYNTH_PROFILE_RUN(voice->nodes[i].type, n, synthBlockNode(voice, scratch, i, n));
+    }
+    for (int i = 0; i < nodeCount; i++) {
+        voice->nodes[i].output = scratch->buffers[i][n];
+    }
+    return &scratch->buffers[voice->outputNode][1];
+}
+
+//synthBlockBegin counted n samples of the voice that won't run. this may be a render thread, so leave them for it to take back
+static inline void synthVoiceSkipped(SynthVoice_t *voice, int n) {
+    voice->nodesSkipped += (n * voice->nodeCount) << voice->oversample;
+}
+
+void synthProcessVoiceBlock(SynthVoice_t *voice, SynthBlockScratch_t *scratch, int32_t *mix, int n) {
+    if (voice->nodeCount == 0 || voice->idle) {
+        synthVoiceSkipped(voice, n);
+        return;
+    }
+    if (voice->feedback || voice->tapOverflow || voice->glideLeft) {
+        //nodes in a feedback loop need each other's previous sample, run a sample at a time.
+        //so does a gliding voice, its pitch changes every sample
+        for (int t = 0; t < n; t++) {
+            mix[t] += synthProcessVoice(voice);
+            if (!voice->gate) {
+                synthVoiceCheckIdle(voice);
+                if (voice->idle) {
+                    synthVoiceSkipped(voice, n - 1 - t);
+                    return;
+                }
+            }
+        }
+        return;
+    }
+    if (voice->oversample) {
+        //the nodes run over as many oversampled samples as fit in the scratch buffers at a time
+        int shift = voice->oversample;
+        for (int offset = 0; offset < n; offset += SYNTH_BLOCK_SIZE >> shift) {
+            int count = n - offset < SYNTH_BLOCK_SIZE >> shift ? n - offset : SYNTH_BLOCK_SIZE >> shift;
+            const q15_t *voiceOut = synthVoiceRunBlock(voice, scratch, count << shift);
+            for (int t = 0; t < count; t++) {
+                mix[offset + t] += synthDecimate(voice->decimator, shift, &voiceOut[t << shift]);
+            }
+        }
+    } else {
+        const q15_t *voiceOut = synthVoiceRunBlock(voice, scratch, n);
+        for (int t = 0; t < n; t++) {
+            mix[t] += voiceOut[t];
+        }
+    }
+    if (!voice->gate) {
+        synthVoiceCheckIdle(voice);
+    }
+}
+
+int synthBlockBegin(Synth_t *synth, size_t n) {
+    for (int vi = 0; vi < synth->voiceCount; vi++) {
+        synthVoiceCheckSchedule(&synth->voices[vi]);
+        if (synth->voices[vi].linked) {
+            return 0;
+        }
+    }
+    for (int vi = 0; vi < synth->voiceCount; vi++) {
+        SynthVoice_t *voice = &synth->voices[vi];
+        synth->nodesRun -= voice->nodesSkipped;
+        voice->nodesSkipped = 0;
+        //idle voices are counted too, synthProcessVoiceBlock gives back whatever didn't run
+        synth->nodesTotal += (voice->nodeCount * n) << voice->oversample;
+        synth->nodesRun += (voice->nodeCount * n) << voice->oversample;
+    }
+    return 1;
+}
+
+void synthProcessBlock(Synth_t *synth, q15_t *out, size_t n) {
+    int32_t mix[SYNTH_BLOCK_SIZE];
+    SynthBlockScratch_t *scratch = synthBlockScratch(synth);
+    while (n > 0) {
+        int count = n < SYNTH_BLOCK_SIZE ? n : SYNTH_BLOCK_SIZE;
+        if (!scratch || !synthBlockBegin(synth, count)) {
+            //voices wired to each other have to run a sample at a time
+            for (int t = 0; t < count; t++) {
+                out[t] = synthProcess(synth);
+            }
+            out += count;
+            n -= count;
+            continue;
+        }
+        memset(mix, 0, count * sizeof(int32_t));
+        for (int vi = 0; vi < synth->voiceCount; vi++) {
+            synthProcessVoiceBlock(&synth->voices[vi], scratch, mix, count);
+        }
+        synthMixdown(synth, mix, out, count);
+        out += count;
+        n -= count;
+    }
+}
+
+
+
+//stereo and bus output. a voice's level in each channel of every bus, from its pan, bus and sends.
+//pan is constant power, the sine and cosine of pan mapped onto a quarter cycle
+static void synthVoiceBusGains(const SynthVoice_t *voice, int32_t *gains) {
+    int32_t angle = (voice->pan + Q15_MAX + 1) >> 3;
+    int32_t left = sineWaveInline(angle + 0x2000);
+    int32_t right = sineWaveInline(angle);
+    for (int b = 0; b < SYNTH_BUSES; b++) {
+        int32_t level = b == voice->bus ? Q15_MAX : voice->sends[b];
+        gains[b * 2] = (left * level) >> 15;
+        gains[b * 2 + 1] = (right * level) >> 15;
+    }
+}
+
+//add a voice's sample to one frame of every bus
+static inline void synthBusAdd(int32_t *frame, const int32_t *gains, int32_t value) {
+    for (int c = 0; c < SYNTH_BUSES * 2; c++) {
+        frame[c] += (value * gains[c]) >> 15;
+    }
+}
+
+void synthProcessBlockStereo(Synth_t *synth, q15_t *out, size_t n) {
+    const int channels = SYNTH_BUSES * 2;
+    int32_t mix[SYNTH_BLOCK_SIZE * SYNTH_BUSES * 2];
+    int32_t voiceMix[SYNTH_BLOCK_SIZE];
+    int32_t gains[SYNTH_BUSES * 2];
+    SynthBlockScratch_t *scratch = synthBlockScratch(synth);
+    while (n > 0) {
+        int count = n < SYNTH_BLOCK_SIZE ? n : SYNTH_BLOCK_SIZE;
+        memset(mix, 0, count * channels * sizeof(int32_t));
+        if (!scratch || !synthBlockBegin(synth, count)) {
+            //voices wired to each other have to run a sample at a time
+            for (int t = 0; t < count; t++) {
+                for (int vi = 0; vi < synth->voiceCount; vi++) {
+                    SynthVoice_t *voice = &synth->voices[vi];
+                    synthVoiceBusGains(voice, gains);
+                    synthBusAdd(&mix[t * channels], gains, synthProcessVoiceSample(synth, voice));
+                }
+            }
+        } else {
+            for (int vi = 0; vi < synth->voiceCount; vi++) {
+                SynthVoice_t *voice = &synth->voices[vi];
+                if (voice->idle || voice->nodeCount == 0) {
+                    synthVoiceSkipped(voice, count);
+                    continue;
+                }
+                //pan and sends only change between blocks
+                synthVoiceBusGains(voice, gains);
+                memset(voiceMix, 0, count * sizeof(int32_t));
+                synthProcessVoiceBlock(voice, scratch, voiceMix, count);
+                for (int t = 0; t < count; t++) {
+                    synthBusAdd(&mix[t * channels], gains, voiceMix[t]);
+                }
+            }
+        }
+        for (int k = 0; k < count * channels; k++) {
+            out[k] = synthMainMix(synth, mix[k]);
+        }
+        out += count * channels;
+        n -= count;
+    }
+}
+
 
 //these wave generator functions all take a basic ramping sawtooth between 0 and 1 as input
 //and return a waveform between -1 and 1
@@ -230,7 +1397,7 @@ q15_t synthProcess() {
 
 //lut = []; for (i = 0; i < 128; i++) {a = (i/128) * Math.PI*2 ; lut[i] = Math.round(Math.sin(a) * 127);}; console.log(JSON.stringify(lut))
 #if SYNTH_SINE_LUT_8BIT
-static const q7_t sineLut[128 + 1] = {
+const q7_t sineLut[128 + 1] = {
     0,6,12,19,25,31,37,43,49,54,60,65,71,76,81,85,90,94,98,102,106,109,112,115,117,
     120,122,123,125,126,126,127,127,127,126,126,125,123,122,120,117,115,112,109,106,
     102,98,94,90,85,81,76,71,65,60,54,49,43,37,31,25,19,12,6,0,-6,-12,-19,-25,-31,
@@ -243,7 +1410,7 @@ static const q7_t sineLut[128 + 1] = {
 
 #else
 
-static const q15_t sineLut16[256 + 1] = {
+const q15_t sineLut16[256 + 1] = {
     0,804,1608,2410,3212,4011,4808,5602,6393,7179,7962,8739,9512,10278,11039,11793,
     12539,13279,14010,14732,15446,16151,16846,17530,18204,18868,19519,20159,20787,21403,
     22005,22594,23170,23731,24279,24811,25329,25832,26319,26790,27245,27683,28105,28510,
@@ -268,76 +1435,49 @@ static const q15_t sineLut16[256 + 1] = {
 #endif
 
 q15_t sawtoothWave(q15_t input) {
-    return input * 2 - Q15_MAX;
+    return sawtoothWaveInline(input);
 }
 
 q15_t sineWave(q15_t input) {
-#if SYNTH_SINE_LUT_8BIT
-    int index = (input >> 8) & 0x7F;
-    q15_t res = sineLut[index] * 258; //multiply by 258 to get full range
-#if SYNTH_INTERPOLATE
-    q15_t next = sineLut[index + 1] * 258;
-    res += ((next - res) * (input & 0xFF) >> 8);
-#endif
-
-#else //16 bit
-    int index = (input >> 7) & 0xFF;
-    q15_t res = sineLut16[index];
-#if SYNTH_INTERPOLATE
-    q15_t next = sineLut16[index + 1];
-    res += ((next - res) * (input & 0x7F) >> 7);
-#endif
-
-#endif //16
-    return res;
+    return sineWaveInline(input);
 }
 
 q15_t squareWave(q15_t input) {
-    return input < Q15_MAX/2 ? Q15_MAX : Q15_MIN;
+    return squareWaveInline(input);
 }
 
 q15_t triangleWave(q15_t input) {
-    int32_t res = input<<1; 
-    if (res > Q15_MAX) {
-        res = Q15_MAX - (res - Q15_MAX);
-    }
-    return res*2 - Q15_MAX;
+    return triangleWaveInline(input);
 }
 
-//sawtooth wave falling
 q15_t fallingWave(q15_t input) {
-    return Q15_MAX - input*2;
+    return fallingWaveInline(input);
 }
 
-//exponentially decaying
 q15_t expDecayWave(q15_t input) {
-    //invert input so that it decays
-    input = (Q15_MAX - input);
-    input = (input * input) >> 15;
-    input = (input * input) >> 15;
-    return input;
+    return expDecayWaveInline(input);
+}
+
+q15_t sawtoothWaveBl(q15_t input, q15_t increment) {
+    return sawtoothWaveBlInline(input, increment);
+}
+
+q15_t squareWaveBl(q15_t input, q15_t increment) {
+    return squareWaveBlInline(input, increment);
+}
+
+q15_t pulseWaveBl(q15_t input, q15_t increment) {
+    return pulseWaveBlInline(input, increment);
 }
 
+static uint32_t synthNoiseState = SYNTH_NOISE_SEED;
+
 q15_t noise() {
-    //based on ranqd1 random number generator from Numerical Recipes
-    //it will cycle every possible 32 bit value before repeating
-    static uint32_t seed = 0x12345678;
-    seed = (seed * 1664525 + 1013904223);
-    return seed & 0xFFFF;
+    synthNoiseState = synthNoiseStep(synthNoiseState);
+    return synthNoiseOutput(synthNoiseState);
 }
 
-//sine based clipper. close to linear up to 50% of q15, then smooths out
+//close to linear up to 50% of q15, then smooths out. a polynomial or the sine table, see SYNTH_CLIPPER_POLY
 q15_t softClipper(int32_t input) {
-    //use the first quadrant of a sine wave as a compressor
-    int sign = input < 0 ? -1 : 1;
-    input = input > 0 ? input : -input;
-    int32_t a = input >> 3; //divide by 8, a 50% vallue will end up around 70%, while higher values will be compressed with the top of the sine wave
-    //clip to a quadrant
-    if (a > Q15_MAX/4) {
-        // __asm("BKPT #0\n");
-        a = Q15_MAX/4;
-    }
-    q15_t res = sineWave(a);
-    res = (res * sign);      
-    return res;
+    return softClipperInline(input);
 }
@@ -4,20 +4,76 @@
 #define __SYNTH_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 //CONFIG stuff
 
 //use 8 bit 128 sample LUT for sine wave, or 16 bit 256 sample LUT
+#ifndef SYNTH_SINE_LUT_8BIT
 #define SYNTH_SINE_LUT_8BIT 1
+#endif
 //enable interpolation between LUT values
+#ifndef SYNTH_INTERPOLATE
 #define SYNTH_INTERPOLATE 1
+#endif
 
 #ifndef SAMPLE_RATE
 #define SAMPLE_RATE 11025
 #endif
 
+//most nodes a voice can have. voices only take up the nodes they are given, see synthVoiceAlloc
+#ifndef SYNTH_NODES
 #define SYNTH_NODES 8
-#define SYNTH_VOICES 2
+#endif
+
+//use SIMD kernels in synthProcessBlock where the target has them (SSE2/AVX2, NEON, Cortex-M DSP extension).
+//results are identical either way
+#ifndef SYNTH_SIMD
+#define SYNTH_SIMD 1
+#endif
+
+//stereo buses for synthProcessBlockStereo. every voice plays into one bus (voice->bus), and can send to the others
+#ifndef SYNTH_BUSES
+#define SYNTH_BUSES 1
+#endif
+
+//soft clipper curve: 1 for an odd polynomial (a few multiplies, no table), 0 for the first quadrant of the sine table.
+//both are close to linear for small inputs and level off smoothly at full scale, see bench.c for how they compare
+#ifndef SYNTH_CLIPPER_POLY
+#define SYNTH_CLIPPER_POLY 1
+#endif
+
+//master stage for the final mix: 0 scales the sum of the voices down by the number of voices so it can never clip,
+//1 runs it through softClipper instead, which keeps the level of a few voices and saturates when many are loud
+#ifndef SYNTH_SOFT_MASTER
+#define SYNTH_SOFT_MASTER 0
+#endif
+
+//32 bit oscillator phase and phase increments, for accurate tuning of low notes and slow LFOs.
+//otherwise phase is 15 bits, and increments are q15
+#ifndef SYNTH_PHASE_32
+#define SYNTH_PHASE_32 0
+#endif
+
+//count the time spent in each node type, see synthProfile
+#ifndef SYNTH_PROFILE
+#define SYNTH_PROFILE 0
+#endif
+
+//largest control rate shift for synthNodeSetRate
+#define SYNTH_CONTROL_RATE_MAX 8
+
+//max samples rendered per pass by synthProcessBlock, longer requests are split up.
+//each node gets a scratch buffer of this size
+#ifndef SYNTH_BLOCK_SIZE
+#define SYNTH_BLOCK_SIZE 32
+#endif
+
+//secondary node outputs (e.g. a state variable filter's band pass) other nodes in a voice can read in synthProcessBlock.
+//each gets a scratch buffer. a voice that reads more of them than this runs a sample at a time
+#ifndef SYNTH_TAPS
+#define SYNTH_TAPS 2
+#endif
 
 
 #ifndef q15_t
@@ -30,6 +86,14 @@ typedef int16_t q15_t;
 #define Q15_MIN 0x8000
 #endif
 
+#if SYNTH_PHASE_32
+typedef uint32_t SynthPhase_t; //a full cycle is 2^32
+#define SYNTH_GLIDE_SHIFT 0
+#else
+typedef q15_t SynthPhase_t; //a full cycle is 2^15
+#define SYNTH_GLIDE_SHIFT 16 //fraction bits for glides
+#endif
+
 #ifndef q7_t
 typedef int8_t q7_t;
 #endif
@@ -48,13 +112,30 @@ typedef int8_t q7_t;
 //oscillators have a pitch and gain input. 
 
 
+//a bank of single cycle waveforms (frames) for wavetable oscillators. banks are only read, so any number of nodes
+//and voices can share one, and the samples stay where they are: const data in flash on a MCU, or a bank file
+//mapped into memory on a host (see synth_wavetable.h)
+typedef struct SynthWavetable {
+    const q15_t *samples; //frameCount frames of 1 << bits samples, one after another
+    uint16_t frameCount; //at least 1
+    uint8_t bits; //log2 of the frame size, up to 15
+} SynthWavetable_t;
+
+//a bank made from a const array of frames with 1 << bits samples each
+#define SYNTH_WAVETABLE(samples, bits) {(samples), (sizeof(samples) / sizeof(q15_t)) >> (bits), (bits)}
+
 //oscilators use a phase accumulator to generate waveforms, which is fast since its just added each sample
-//phase stays positive, wrapps at Q15_MAX (15 bits)
+//phase stays positive, wrapps at Q15_MAX (15 bits), or uses all 32 bits with SYNTH_PHASE_32 (the top 15 go to the wavegen)
 //phase incremeent2 is used for FM, and is added to the phase increment while keeping the base frequency
 typedef struct SynthOscillator {
-    q15_t *phaseIncrement; //calculated from frequency
-    q15_t *detune; //+- phase increment for FM
-    q15_t (*wavegen)(q15_t input); //waveform generator function
+    SynthPhase_t *phaseIncrement; //calculated from frequency. with SYNTH_PHASE_32 this can't be a node output, use detune
+    q15_t *detune; //+- phase increment for FM, always in 15 bit phase units
+    union {
+        q15_t (*wavegen)(q15_t input); //waveform generator function
+        q15_t (*wavegenBl)(q15_t input, q15_t increment); //band limited waveform generator, for SYNTH_NODE_OSCILLATOR_BL
+        const SynthWavetable_t *table; //bank to play, for SYNTH_NODE_WAVETABLE
+    };
+    q15_t *position; //for SYNTH_NODE_WAVETABLE, the frame to play from 0 (first) to Q15_MAX (last). NULL for the first
 } SynthOscillator_t;
 
 //basic envelope generator
@@ -72,6 +153,36 @@ typedef struct SynthFilter {
     int32_t factor;
 } SynthFilter_t;
 
+//state variable filter, low pass, high pass, band pass and notch from one update
+typedef enum SynthSvfOutput {
+    SYNTH_SVF_LP = 0,
+    SYNTH_SVF_HP,
+    SYNTH_SVF_BP,
+    SYNTH_SVF_NOTCH,
+} SynthSvfOutput_t;
+
+typedef struct SynthSvf {
+    q15_t *input;
+    q15_t *cutoff; //see SYNTH_SVF_CUTOFF, up to SAMPLE_RATE / 6
+    q15_t *resonance; //0 to Q15_MAX (rings on its own), NULL for none
+    int32_t low; //state
+    int32_t band;
+    q15_t outputs[4]; //every response, indexed by SynthSvfOutput_t. other nodes can read these as inputs too
+    uint8_t mode; //the SynthSvfOutput_t the node's output is
+} SynthSvf_t;
+
+//delay line, reading back a fractional number of samples with linear interpolation, and feeding some of what it
+//reads back in. the line comes from the instance's delay pool (see synthDelayPoolInit)
+typedef struct SynthDelay {
+    q15_t *input;
+    q15_t *time; //how far back to read, 0 (1 sample) to Q15_MAX (the whole line), see SYNTH_DELAY_TIME
+    q15_t *feedback; //how much of what's read is added back in, -Q15_MAX to Q15_MAX, NULL for none
+    q15_t *line; //the pool's lineLength samples, NULL if the pool had none free
+    struct SynthDelayPool *pool;
+    uint16_t pos; //where the next sample is written
+    uint16_t mask; //lineLength - 1
+} SynthDelay_t;
+
 //basic mixer
 typedef struct SynthMixer {
     q15_t *inputs[3];
@@ -85,44 +196,270 @@ typedef enum SynthNodeType {
     SYNTH_NODE_FILTER_LP,
     SYNTH_NODE_FILTER_HP,
     SYNTH_NODE_MIXER,
+    SYNTH_NODE_OSCILLATOR_BL, //oscillator with a band limited wave generator that also gets the phase increment
+    SYNTH_NODE_WAVETABLE, //oscillator playing frames from a SynthWavetable_t
+    SYNTH_NODE_FILTER_SVF, //resonant state variable filter
+    SYNTH_NODE_NOISE, //white noise, with its own generator state
+    SYNTH_NODE_DELAY, //delay line with feedback, for echo, chorus, flanging, comb filters and plucked strings
     SYNTH_NODE_END
 } SynthNodeType_t;
 
+//what a note on does to a node's state, see synthNodeSetRetrigger
+typedef enum SynthRetrigger {
+    SYNTH_RETRIGGER_RESET = 0, //start over: oscillators from phase 0, envelopes from 0
+    SYNTH_RETRIGGER_FREE, //carry on as if nothing happened, e.g. a free running LFO or an envelope that only plays once
+    SYNTH_RETRIGGER_LEVEL, //envelopes attack again from their current level instead of 0. other nodes reset
+} SynthRetrigger_t;
+
 typedef struct SynthNode {
-    int32_t state; //state for the node, could be phase, envelope state, etc. this gets reset when a note is triggered (aka gate)
+    int32_t state; //state for the node, could be phase, envelope state, etc. this gets reset when a note is triggered (aka gate),
+                   //except for noise, where it's the generator state, and delay, where it counts silent samples written
     q15_t *gain; //pointer to gain input
+    struct SynthVoice *voice; //voice the node belongs to, set by synthVoiceAlloc and kept by synthNodeClear
     q15_t output;
     SynthNodeType_t type;
     uint8_t param1; //TODO maybe use this as gain range
+    uint8_t rate; //control rate, run every 1 << rate samples. see synthNodeSetRate
+    uint8_t tick; //samples since the last control rate update
+    uint8_t retrigger; //SynthRetrigger_t, see synthNodeSetRetrigger
+    q15_t rampFrom; //control rate output ramps from the previous value to the new one
+    q15_t rampTo;
     union {
         struct SynthOscillator osc;
         struct SynthEnvelope env;
         struct SynthFilter filter;
         struct SynthMixer mixer;
+        struct SynthSvf svf;
+        struct SynthDelay delay;
     };
 } SynthNode_t;
 
+//a patch parameter owned by a voice, e.g. a level or an LFO rate a loaded patch wires its nodes to (see synth_patch.h).
+//nodes read value as a q15 input, or increment as a phase increment
+typedef union SynthParam {
+    q15_t value;
+    SynthPhase_t increment;
+} SynthParam_t;
+
+//oversampling: a voice can run its nodes at 2 or 4 times SAMPLE_RATE, and be brought back down by halfband decimators.
+//the last stage has SYNTH_HALFBAND_TAPS coefficient pairs, passing up to 0.4 of the output rate (4.4kHz at 11025)
+//and taking at least 57dB off anything that would fold back into that. the first stage for 4x is shorter, 3 pairs
+#define SYNTH_OVERSAMPLE_MAX 2 //as a shift, 4x
+#define SYNTH_HALFBAND_TAPS 8
+
+//one halfband stage, taking 2 samples in for each one out. only the center tap of the odd samples is non-zero,
+//so the even samples go through the coefficients and the odd ones through a delay
+typedef struct SynthHalfband {
+    q15_t even[4 * SYNTH_HALFBAND_TAPS]; //the last 2 * taps even samples from pos, written twice so they read in order
+    q15_t odd[SYNTH_HALFBAND_TAPS]; //odd samples waiting taps pairs to reach the center tap
+    uint8_t pos;
+    uint8_t oddPos;
+} SynthHalfband_t;
+
+//stages[0] is the last one, stages[1] goes from 4x to 2x
+typedef struct SynthDecimator {
+    SynthHalfband_t stages[SYNTH_OVERSAMPLE_MAX];
+} SynthDecimator_t;
+
 typedef struct SynthVoice {
+    struct Synth *synth; //instance the voice belongs to
     uint8_t note; //midi note
     uint8_t gate : 1; //gate on/off
-    q15_t phaseIncrement; //calculated from frequency
-    SynthNode_t nodes[SYNTH_NODES];
+    uint8_t feedback : 1; //some nodes feed back into each other, set by synthVoiceSchedule
+    uint8_t linked : 1; //some nodes read from another voice, set by synthVoiceSchedule
+    uint8_t idle : 1; //released and silent, skipped until the next note on
+    uint8_t tapOverflow : 1; //reads more secondary outputs than SYNTH_TAPS, set by synthVoiceSchedule
+    uint8_t legato : 1; //a note on while the gate is still on only changes the pitch, no nodes are retriggered
+    uint8_t rewired : 1; //a node was wired up since the last synthVoiceSchedule, so it runs again before the next sample
+    uint8_t outputNode; //index of the node used as the voice's output, 0 by default
+    uint8_t nodeCapacity; //nodes given to the voice by synthVoiceAlloc
+    uint8_t nodeCount; //nodes in use, up to the first SYNTH_NODE_NONE. set by synthVoiceSchedule
+    uint8_t order[SYNTH_NODES]; //order the nodes run in, set by synthVoiceSchedule
+    uint8_t tapCount; //secondary outputs read by the voice's nodes, set by synthVoiceSchedule
+    uint8_t taps[SYNTH_TAPS]; //which ones, node index << 2 | output
+    SynthPhase_t phaseIncrement; //calculated from frequency
+    uint16_t glide; //portamento, samples to slide from the pitch the voice is playing to a new note's (see SYNTH_MS). 0 jumps
+    uint16_t glideLeft; //samples until phaseIncrement reaches glideTarget, 0 when it isn't gliding
+    SynthPhase_t glideTarget;
+    uint32_t glideAt; //phaseIncrement << SYNTH_GLIDE_SHIFT while gliding, so slow glides don't stall on 15 bit phase
+    int32_t glideStep;
+    q15_t pan; //stereo position for synthProcessBlockStereo, -Q15_MAX (left) to Q15_MAX (right), 0 is center
+    uint8_t bus; //bus the voice plays into at full level, 0 by default
+    q15_t sends[SYNTH_BUSES]; //levels the voice also plays into other buses at, e.g. for a reverb or delay bus
+    SynthNode_t *nodes; //nodeCapacity nodes in the instance's arena
+    SynthParam_t *params; //paramCount parameters in the instance's arena, for loaded patches
+    uint8_t paramCount;
+    uint8_t oversample; //nodes run at SAMPLE_RATE << oversample, see synthVoiceSetOversample
+    SynthDecimator_t *decimator; //in the instance's arena, once the voice has been oversampled
+    uint64_t nodesSkipped; //node runs synthBlockBegin counted that didn't happen, the voice was or went idle. 64 bit, the render pool counts a whole render
 } SynthVoice_t;
 
-extern SynthVoice_t synthVoices[SYNTH_VOICES];
+//equal length delay lines for the delay nodes of an instance's voices, taken from its arena once by
+//synthDelayPoolInit, so delay nodes don't allocate anything as they're wired and rewired
+typedef struct SynthDelayPool {
+    q15_t *samples; //lineCount lines of lineLength samples
+    uint16_t lineLength;
+    uint8_t lineCount;
+    uint32_t used; //a bit for each line a node has
+} SynthDelayPool_t;
+
+//most lines a pool can have
+#define SYNTH_DELAY_LINES 32
+
+//scratch space for rendering a voice a block at a time, one for each thread rendering at once
+typedef struct SynthBlockScratch {
+    q15_t buffers[SYNTH_NODES][SYNTH_BLOCK_SIZE + 1];
+    q15_t phase[SYNTH_BLOCK_SIZE]; //oscillator phases for the block
+    q15_t increment[SYNTH_BLOCK_SIZE]; //and how far the phase moved each sample, for band limited oscillators
+    q15_t taps[SYNTH_TAPS][SYNTH_BLOCK_SIZE + 1]; //secondary outputs, laid out like buffers
+} SynthBlockScratch_t;
 
-q15_t midiToPhaseIncr(uint8_t note);
+//a synth instance: a set of voices mixed together, and all of their nodes, carved out of one arena the caller provides.
+//instances are independent of each other, so one can e.g. run per output or per thread
+typedef struct Synth {
+    SynthVoice_t *voices;
+    uint16_t voiceCount;
+    q15_t mixGain; //main mixer gain, Q15_MAX / voiceCount
+    uint8_t *arena;
+    size_t arenaSize;
+    size_t arenaUsed;
+    SynthBlockScratch_t *scratch; //for synthProcessBlock, taken from the arena on first use
+    SynthDelayPool_t delayPool; //lines for delay nodes, empty until synthDelayPoolInit
+    uint64_t nodesRun; //node runs for the load stats, compared to what it would take to run every voice
+    uint64_t nodesTotal;
+} Synth_t;
 
+//arena allocations are rounded up to this
+#define SYNTH_ARENA_ALIGN 8
+#define SYNTH_ARENA_ROUND(size) (((size) + SYNTH_ARENA_ALIGN - 1) & ~(size_t) (SYNTH_ARENA_ALIGN - 1))
+//arena bytes for an instance with voices voices and nodes nodes between them, including the block scratch
+//and room to align the start. leave out SYNTH_ARENA_ROUND(sizeof(SynthBlockScratch_t)) if only using synthProcess
+#define SYNTH_ARENA_SIZE(voices, nodes) (SYNTH_ARENA_ALIGN + SYNTH_ARENA_ROUND((voices) * sizeof(SynthVoice_t)) \
+        + (nodes) * sizeof(SynthNode_t) + (voices) * SYNTH_ARENA_ALIGN + SYNTH_ARENA_ROUND(sizeof(SynthBlockScratch_t)))
+
+//set up an instance with voiceCount voices (no nodes yet) in size bytes of arena. the arena must outlive the instance,
+//and is all the memory it uses. returns 0, or -1 if the arena is too small
+int synthInit(Synth_t *synth, void *arena, size_t size, int voiceCount);
+//give voice index nodeCount (up to SYNTH_NODES) cleared nodes from the arena, ready to wire up with synthInit*Node.
+//each voice can be given nodes once, until the next synthInit. returns the voice, or NULL if the arena is full
+SynthVoice_t *synthVoiceAlloc(Synth_t *synth, int index, int nodeCount);
+//take size cleared bytes from the instance's arena, e.g. for voice->params. NULL if the arena is full
+void *synthArenaAlloc(Synth_t *synth, size_t size);
+//give the instance lines delay lines (up to SYNTH_DELAY_LINES) of length samples (a power of 2, up to 32768) from
+//its arena, shared by the delay nodes of all of its voices. e.g. a few long lines for echo, or a short one per voice
+//for plucked strings. it can only be done once per synthInit. returns 0, or -1 if it's already done, the arguments
+//are out of range or the arena is full (add SYNTH_DELAY_POOL_SIZE(lines, length) to SYNTH_ARENA_SIZE)
+int synthDelayPoolInit(Synth_t *synth, int lines, int length);
+#define SYNTH_DELAY_POOL_SIZE(lines, length) SYNTH_ARENA_ROUND((size_t) (lines) * (length) * sizeof(q15_t))
+
+SynthPhase_t midiToPhaseIncr(uint8_t note);
+//phase increment for a midi note plus cents (+-, 100 per semitone), rounded to the nearest step.
+//finer than midiToPhaseIncr, especially for low notes, and can be used for pitch bend
+SynthPhase_t midiToPhaseIncrCents(uint8_t note, int32_t cents);
+//cents for a 14 bit midi pitch bend value (-8192 to 8191, center 0) with a bend range of +- semitones
+#define SYNTH_BEND_CENTS(bend, semitones) (((int32_t) (bend) * (semitones) * 100) / 8192)
+
+//work out the order to run a voice's nodes in, so every node sees the current output of the nodes it reads from.
+//nodes that feed back into each other see the previous sample's output of the nodes that run after them.
+//this happens automatically after any synthInit*Node call, call it yourself after changing wiring by hand.
+void synthVoiceSchedule(SynthVoice_t *voice);
+
+//start a note: retrigger the voice's nodes (see synthNodeSetRetrigger) and set its pitch, sliding there over
+//voice->glide samples if the voice is still sounding. with voice->legato set and the gate still on, only the pitch changes
 void synthVoiceNoteOn(SynthVoice_t *voice, uint8_t note);
 void synthVoiceNoteOff(SynthVoice_t *voice);
+//retune the voice's current note by cents, e.g. for pitch bend. doesn't retrigger anything.
+//while the voice is gliding, the glide heads for the bent pitch instead
+void synthVoiceBend(SynthVoice_t *voice, int32_t cents);
+//run a voice's nodes at SAMPLE_RATE << shift (0 to SYNTH_OVERSAMPLE_MAX) and decimate them back down, so the
+//waveforms and anything else nonlinear alias less, at shift times the cost, without raising the rate of every voice.
+//notes, bends and glide are taken care of, but everything else in the patch that counts samples sees the higher
+//rate: envelope rates, LFO and other fixed phase increments, filter factors and cutoffs and delay times, so e.g.
+//halve envelope rates for 2x. the decimators delay the voice by about 8 samples. the first time, the voice takes
+//SYNTH_OVERSAMPLE_SIZE from the instance's arena (add it to SYNTH_ARENA_SIZE for each voice that's oversampled).
+//compiled patches and voice packs don't oversample. returns 0, or -1 if shift is out of range or the arena is full
+int synthVoiceSetOversample(SynthVoice_t *voice, int shift);
+#define SYNTH_OVERSAMPLE_SIZE SYNTH_ARENA_ROUND(sizeof(SynthDecimator_t))
+//mark a voice idle once the gate is off, every envelope has released to 0 and its output is 0.
+//idle voices are skipped until the next note on. voices without envelopes never go idle.
+//called by the renderers, only needed when rendering a voice yourself
+void synthVoiceCheckIdle(SynthVoice_t *voice);
+//number of voices that are making sound (not idle)
+int synthActiveVoices(Synth_t *synth);
+//fraction of the node runs of every voice that idle voices saved since the last call, in q15.
+//Q15_MAX means nothing needed to run, 0 means every voice was busy. every node counts the same, so it's a proxy
+//for CPU time, not a measure of it: an svf costs several times what a mixer does (see SYNTH_PROFILE for real
+//cycles). the counts are 64 bit, so it can go uncalled for as long as you like
+q15_t synthHeadroom(Synth_t *synth);
 
-void synthInitOscNode(SynthNode_t *node, q15_t *gain, q15_t *phaseIncrement, q15_t *detune, q15_t (*wavegen)(q15_t input));
+void synthInitOscNode(SynthNode_t *node, q15_t *gain, SynthPhase_t *phaseIncrement, q15_t *detune, q15_t (*wavegen)(q15_t input));
+//band limited oscillator, wavegen is sawtoothWaveBl, squareWaveBl, pulseWaveBl or your own (see synth_inline.h)
+void synthInitOscBlNode(SynthNode_t *node, q15_t *gain, SynthPhase_t *phaseIncrement, q15_t *detune, q15_t (*wavegen)(q15_t input, q15_t increment));
+//wavetable oscillator, plays the bank's frames interpolated, crossfading between the two frames either side of position
+void synthInitWavetableNode(SynthNode_t *node, q15_t *gain, SynthPhase_t *phaseIncrement, q15_t *detune, const SynthWavetable_t *table, q15_t *position);
 void synthInitEnvelopeNode(SynthNode_t *node, q15_t *gain, q15_t attack, q15_t decay, q15_t sustain, q15_t release);
 void synthInitFilterLpNode(SynthNode_t *node, q15_t *gain, q15_t *input, q15_t factor);
 void synthInitFilterHpNode(SynthNode_t *node, q15_t *gain, q15_t *input, q15_t factor);
 void synthInitMixerNode(SynthNode_t *node, q15_t *gain, q15_t *input1, q15_t *input2, q15_t *input3);
+//the node's output is the mode response, all four can be read from node->svf.outputs. gain applies to all of them
+void synthInitFilterSvfNode(SynthNode_t *node, q15_t *gain, q15_t *input, q15_t *cutoff, q15_t *resonance, SynthSvfOutput_t mode);
+//white noise from a xorshift generator of its own, so voices don't share a stream and it's safe to run voices on
+//different threads. nodes with the same seed play the same noise, so give each voice its own (0 picks a default)
+//the generator isn't reset on note on, and synthProcessBlock only sees a voice go idle at the end of a block, so
+//after a voice has gone idle its noise carries on from a different point than with synthProcess
+void synthInitNoiseNode(SynthNode_t *node, q15_t *gain, uint32_t seed);
+//delay node with a line from pool (usually &voice->synth->delayPool), reading back time and adding feedback times
+//what it reads to input as it writes. a node that already has a line from the pool keeps it, and the line is cleared.
+//the line isn't cleared on note on, so echoes and strings ring on into the next note, and the voice only goes idle
+//once a whole line of silence has been written. a delay in a feedback loop with other nodes (e.g. a filter for a
+//plucked string) makes the voice run a sample at a time, so keep the loop inside the node where possible.
+//returns 0, or -1 if the pool has no free lines, in which case the node is silent
+int synthInitDelayNode(SynthNode_t *node, q15_t *gain, q15_t *input, q15_t *time, q15_t *feedback, SynthDelayPool_t *pool);
+//reset a node to SYNTH_NODE_NONE, giving back anything it holds, like a delay node's line.
+//every synthInit*Node does this first, so a delay node rewired as something else returns its line
+void synthNodeClear(SynthNode_t *node);
+
+//run an envelope or (non band limited) oscillator at a control rate of SAMPLE_RATE >> rate, for modulation sources
+//like envelopes and LFOs. the node works out its next value every 1 << rate samples, with the envelope rates and
+//phase increments scaled up to keep the same timing and pitch, and its output ramps linearly to it in between.
+//inputs are only read on those samples. rate is 0 (every sample) to SYNTH_CONTROL_RATE_MAX, ignored for other node types
+void synthNodeSetRate(SynthNode_t *node, uint8_t rate);
+
+//what a note on does to the node, SYNTH_RETRIGGER_RESET by default (noise always carries on). FREE keeps LFOs
+//running across notes, and LEVEL restarts an envelope's attack from wherever it is, so a voice that is retriggered
+//or stolen mid note doesn't click and doesn't need a long release to hide it. nodes that carry on across notes
+//continue from a different point with synthProcessBlock once a voice has gone idle, see synthInitNoiseNode
+void synthNodeSetRetrigger(SynthNode_t *node, SynthRetrigger_t retrigger);
 
-q15_t synthProcess();
+q15_t synthProcess(Synth_t *synth);
+//fill out with n samples, same result as calling synthProcess() n times
+void synthProcessBlock(Synth_t *synth, q15_t *out, size_t n);
+//apply the main mixer gain to a buffer of summed voice outputs
+void synthMixdown(Synth_t *synth, const int32_t *mix, q15_t *out, size_t n);
+//fill out with n interleaved stereo frames of every bus: bus 0 left, bus 0 right, bus 1 left... (just left, right
+//with one bus). voices are panned with a constant power pan law and mixed into their buses, then each channel goes
+//through the master stage. a voice panned to center comes out 3dB quieter on each side than it is in synthProcess
+void synthProcessBlockStereo(Synth_t *synth, q15_t *out, size_t n);
+
+//the pieces of synthProcessBlock, for running voices on other threads.
+//synthBlockBegin gets the voices ready to render the next n samples (and counts them for synthHeadroom), and returns 0 if they are wired
+//to each other and have to go through synthProcess instead. then each voice can be run independently
+//with synthProcessVoiceBlock, which adds up to SYNTH_BLOCK_SIZE samples of the voice into mix
+int synthBlockBegin(Synth_t *synth, size_t n);
+void synthProcessVoiceBlock(SynthVoice_t *voice, SynthBlockScratch_t *scratch, int32_t *mix, int n);
+
+#if SYNTH_PROFILE
+//time spent running each node type, and how many node samples that covered.
+//time is in DWT cycles on Cortex-M3 and up, TSC cycles on x86, otherwise nanoseconds.
+//define SYNTH_PROFILE_CLOCK() to use your own timer (e.g. SysTick on an M0). not thread safe
+typedef struct SynthProfile {
+    uint64_t cycles[SYNTH_NODE_END];
+    uint32_t samples[SYNTH_NODE_END];
+} SynthProfile_t;
+extern SynthProfile_t synthProfile;
+//clear the counts, and start the cycle counter on Cortex-M
+void synthProfileReset();
+#endif
 
 q15_t sawtoothWave(q15_t input);
 q15_t sineWave(q15_t input);
@@ -130,11 +467,32 @@ q15_t squareWave(q15_t input);
 q15_t triangleWave(q15_t input);
 q15_t fallingWave(q15_t input);
 q15_t expDecayWave(q15_t input);
+//white noise from one generator shared by every caller, use noise nodes in voices
 q15_t noise();
+//band limited versions of the sawtooth and square waves, and a 25% pulse.
+//increment is the phase increment, the jumps in the waveform are smoothed out over that many phase steps
+q15_t sawtoothWaveBl(q15_t input, q15_t increment);
+q15_t squareWaveBl(q15_t input, q15_t increment);
+q15_t pulseWaveBl(q15_t input, q15_t increment);
 q15_t softClipper(int32_t input);
 
 
+//frequency to a 15 bit phase increment, e.g. for detune depths
 #define SYNTH_HZ_TO_PHASE(frequency) ((frequency * Q15_MAX) / SAMPLE_RATE)
+//frequency to a phase increment for an oscillator's phaseIncrement
+#if SYNTH_PHASE_32
+#define SYNTH_HZ_TO_INCREMENT(frequency) ((SynthPhase_t) ((frequency) * 4294967296.0 / SAMPLE_RATE + 0.5))
+#else
+#define SYNTH_HZ_TO_INCREMENT(frequency) SYNTH_HZ_TO_PHASE(frequency)
+#endif
+
+//cutoff input for a state variable filter: 2 * sin(pi * frequency / SAMPLE_RATE) in q15, which tops out at SAMPLE_RATE / 6
+#define SYNTH_SVF_CUTOFF(frequency) SYNTH_SVF_F(3.14159265 * (frequency) / SAMPLE_RATE)
+#define SYNTH_SVF_F(x) ((q15_t) ((x) >= 0.5235987 ? Q15_MAX : 2 * ((x) - (x) * (x) * (x) / 6) * 32768))
+
+//time input for a delay node to read back samples samples (1 to length - 1, can be fractional) on lines of length samples.
+//a plucked string at frequency Hz is a delay of SAMPLE_RATE / frequency samples
+#define SYNTH_DELAY_TIME(samples, length) ((q15_t) ((samples) * 32768.0 / (length) + 0.5))
 
 //convert milliseconds to samples
 #define SYNTH_MS(ms) ((ms * SAMPLE_RATE) / 1000)
@@ -0,0 +1,112 @@
+//sample accurate events, see synth_events.h
+
+#include "synth_events.h"
+
+void synthEventInit(SynthEventQueue_t *queue) {
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    atomic_init(&queue->now, 0);
+}
+
+uint32_t synthEventTime(SynthEventQueue_t *queue) {
+    return atomic_load_explicit(&queue->now, memory_order_relaxed);
+}
+
+int synthEventPush(SynthEventQueue_t *queue, const SynthEvent_t *event) {
+    uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail - head >= SYNTH_EVENT_QUEUE) {
+        return 0;
+    }
+    queue->events[tail & (SYNTH_EVENT_QUEUE - 1)] = *event;
+    //publish the event after it's written
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+int synthEventNoteOn(SynthEventQueue_t *queue, uint32_t time, SynthVoice_t *voice, uint8_t note) {
+    SynthEvent_t event = {.time = time, .type = SYNTH_EVENT_NOTE_ON, .note = note, .voice = voice};
+    return synthEventPush(queue, &event);
+}
+
+int synthEventNoteOff(SynthEventQueue_t *queue, uint32_t time, SynthVoice_t *voice) {
+    SynthEvent_t event = {.time = time, .type = SYNTH_EVENT_NOTE_OFF, .voice = voice};
+    return synthEventPush(queue, &event);
+}
+
+int synthEventPolyNoteOn(SynthEventQueue_t *queue, uint32_t time, SynthPoly_t *poly, uint8_t note) {
+    SynthEvent_t event = {.time = time, .type = SYNTH_EVENT_POLY_NOTE_ON, .note = note, .poly = poly};
+    return synthEventPush(queue, &event);
+}
+
+int synthEventPolyNoteOff(SynthEventQueue_t *queue, uint32_t time, SynthPoly_t *poly, uint8_t note) {
+    SynthEvent_t event = {.time = time, .type = SYNTH_EVENT_POLY_NOTE_OFF, .note = note, .poly = poly};
+    return synthEventPush(queue, &event);
+}
+
+int synthEventSet(SynthEventQueue_t *queue, uint32_t time, q15_t *param, q15_t value) {
+    SynthEvent_t event = {.time = time, .type = SYNTH_EVENT_SET, .value = value, .param = param};
+    return synthEventPush(queue, &event);
+}
+
+int synthEventSetIncrement(SynthEventQueue_t *queue, uint32_t time, SynthPhase_t *increment, SynthPhase_t phaseIncrement) {
+    SynthEvent_t event = {.time = time, .type = SYNTH_EVENT_SET_INCREMENT, .phaseIncrement = phaseIncrement, .increment = increment};
+    return synthEventPush(queue, &event);
+}
+
+static void synthEventApply(const SynthEvent_t *event) {
+    switch (event->type) {
+        case SYNTH_EVENT_NOTE_ON:
+            synthVoiceNoteOn(event->voice, event->note);
+            break;
+        case SYNTH_EVENT_NOTE_OFF:
+            synthVoiceNoteOff(event->voice);
+            break;
+        case SYNTH_EVENT_POLY_NOTE_ON:
+            synthPolyNoteOn(event->poly, event->note);
+            break;
+        case SYNTH_EVENT_POLY_NOTE_OFF:
+            synthPolyNoteOff(event->poly, event->note);
+            break;
+        case SYNTH_EVENT_SET:
+            *event->param = event->value;
+            break;
+        case SYNTH_EVENT_SET_INCREMENT:
+            *event->increment = event->phaseIncrement;
+            break;
+        default:
+            break;
+    }
+}
+
+size_t synthEventDispatch(SynthEventQueue_t *queue, size_t n) {
+    uint32_t now = atomic_load_explicit(&queue->now, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    while (head != tail) {
+        const SynthEvent_t *event = &queue->events[head & (SYNTH_EVENT_QUEUE - 1)];
+        int32_t wait = event->time - now;
+        if (wait > 0) {
+            //render up to the next event
+            if ((uint32_t) wait < n) {
+                n = wait;
+            }
+            break;
+        }
+        synthEventApply(event);
+        head++;
+    }
+    //hand the slots back to the producer
+    atomic_store_explicit(&queue->head, head, memory_order_release);
+    atomic_store_explicit(&queue->now, now + n, memory_order_relaxed);
+    return n;
+}
+
+void synthEventProcessBlock(SynthEventQueue_t *queue, Synth_t *synth, q15_t *out, size_t n) {
+    while (n > 0) {
+        size_t count = synthEventDispatch(queue, n);
+        synthProcessBlock(synth, out, count);
+        out += count;
+        n -= count;
+    }
+}
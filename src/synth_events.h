@@ -0,0 +1,72 @@
+//sample accurate events: note on/off and parameter changes stamped with the sample they should happen on.
+//a lock free single producer, single consumer queue, so events can be pushed from a MIDI ISR or another thread
+//while the audio side renders. the renderer splits its blocks at event times and applies them in between,
+//so nothing has to be checked per sample
+#ifndef __SYNTH_EVENTS_H
+#define __SYNTH_EVENTS_H
+
+#include "synth.h"
+#include "synth_poly.h"
+#include <stdatomic.h>
+
+//events the queue can hold, must be a power of 2
+#ifndef SYNTH_EVENT_QUEUE
+#define SYNTH_EVENT_QUEUE 64
+#endif
+
+typedef enum SynthEventType {
+    SYNTH_EVENT_NOTE_ON = 0, //synthVoiceNoteOn(voice, note)
+    SYNTH_EVENT_NOTE_OFF, //synthVoiceNoteOff(voice)
+    SYNTH_EVENT_POLY_NOTE_ON, //synthPolyNoteOn(poly, note)
+    SYNTH_EVENT_POLY_NOTE_OFF, //synthPolyNoteOff(poly, note)
+    SYNTH_EVENT_SET, //*param = value
+    SYNTH_EVENT_SET_INCREMENT, //*increment = phaseIncrement, for phase increments like an LFO rate
+} SynthEventType_t;
+
+typedef struct SynthEvent {
+    uint32_t time; //sample the event happens on, on the queue's clock (see synthEventTime)
+    uint8_t type;
+    uint8_t note;
+    union {
+        q15_t value;
+        SynthPhase_t phaseIncrement;
+    };
+    union {
+        SynthVoice_t *voice;
+        SynthPoly_t *poly;
+        q15_t *param;
+        SynthPhase_t *increment;
+    };
+} SynthEvent_t;
+
+typedef struct SynthEventQueue {
+    SynthEvent_t events[SYNTH_EVENT_QUEUE];
+    atomic_uint_least32_t head; //next event to apply, only moved by the consumer
+    atomic_uint_least32_t tail; //next free slot, only moved by the producer
+    atomic_uint_least32_t now; //sample clock, counts samples rendered through the queue
+} SynthEventQueue_t;
+
+void synthEventInit(SynthEventQueue_t *queue);
+
+//the queue's clock: the sample the next rendered sample is on. it wraps, and times are compared with wrapping in mind,
+//so events can be up to 2^31 samples in the future
+uint32_t synthEventTime(SynthEventQueue_t *queue);
+
+//producer side. events must be pushed in time order, an event stamped in the past happens at the start of the next block.
+//returns 0 if the queue is full
+int synthEventPush(SynthEventQueue_t *queue, const SynthEvent_t *event);
+int synthEventNoteOn(SynthEventQueue_t *queue, uint32_t time, SynthVoice_t *voice, uint8_t note);
+int synthEventNoteOff(SynthEventQueue_t *queue, uint32_t time, SynthVoice_t *voice);
+int synthEventPolyNoteOn(SynthEventQueue_t *queue, uint32_t time, SynthPoly_t *poly, uint8_t note);
+int synthEventPolyNoteOff(SynthEventQueue_t *queue, uint32_t time, SynthPoly_t *poly, uint8_t note);
+int synthEventSet(SynthEventQueue_t *queue, uint32_t time, q15_t *param, q15_t value);
+int synthEventSetIncrement(SynthEventQueue_t *queue, uint32_t time, SynthPhase_t *increment, SynthPhase_t phaseIncrement);
+
+//consumer side. applies the events that are due, and returns how many samples (up to n) can be rendered before
+//the next one. the clock moves on by that many, so render exactly that many samples before calling it again
+size_t synthEventDispatch(SynthEventQueue_t *queue, size_t n);
+
+//synthProcessBlock, with the queued events applied on the exact samples they are stamped with
+void synthEventProcessBlock(SynthEventQueue_t *queue, Synth_t *synth, q15_t *out, size_t n);
+
+#endif // __SYNTH_EVENTS_H
@@ -0,0 +1,278 @@
+//host only: real time playback through a render thread, a lock free ring of periods and a sink thread
+
+#include "synth_host.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <time.h>
+#if SYNTH_HOST_ALSA
+#include <alsa/asoundlib.h>
+#endif
+
+#if SYNTH_HOST_PERIODS & (SYNTH_HOST_PERIODS - 1)
+#error SYNTH_HOST_PERIODS must be a power of 2
+#endif
+
+struct SynthHost {
+    Synth_t *synth;
+    SynthEventQueue_t *events;
+    SynthHostSink_t sink;
+    FILE *file;
+#if SYNTH_HOST_ALSA
+    snd_pcm_t *pcm;
+#endif
+    unsigned periods; //queued ahead of the sink
+
+    //the ring, the render thread only moves tail and the sink thread only moves head
+    q15_t ring[SYNTH_HOST_PERIODS][SYNTH_HOST_PERIOD];
+    uint64_t rendered[SYNTH_HOST_PERIODS]; //when each period was finished, in ns
+    atomic_uint head;
+    atomic_uint tail;
+    atomic_int quit;
+
+    pthread_t renderThread;
+    pthread_t sinkThread;
+    //the counters synthHostStats reads, each only written by one thread, so neither takes a lock while playing
+    _Atomic uint64_t samples;
+    atomic_uint periodsRendered;
+    atomic_uint underruns;
+    atomic_uint xruns;
+    atomic_uint renderMax;
+    atomic_uint latency[SYNTH_HOST_HISTOGRAM];
+    atomic_int error;
+};
+
+static const q15_t synthHostSilence[SYNTH_HOST_PERIOD];
+
+static uint64_t synthHostNow() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void synthHostSleepUntil(uint64_t ns) {
+    struct timespec ts = {.tv_sec = ns / 1000000000ULL, .tv_nsec = ns % 1000000000ULL};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)) {
+    }
+}
+
+//ns of audio in n samples
+static uint64_t synthHostDuration(uint64_t n) {
+    return n * 1000000000ULL / SAMPLE_RATE;
+}
+
+//ask for real time scheduling, offset below the top priority. without the privileges for it the thread stays as it is
+static void synthHostRealtime(int offset) {
+    struct sched_param param = {.sched_priority = sched_get_priority_max(SCHED_FIFO) - offset};
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+}
+
+static int synthHostBucket(uint64_t us) {
+    int k = 0;
+    while (us >= 2 && k < SYNTH_HOST_HISTOGRAM - 1) {
+        us >>= 1;
+        k++;
+    }
+    return k;
+}
+
+//render periods while there's room for them, checking back every quarter period when the ring is full
+static void *synthHostRenderThread(void *arg) {
+    SynthHost_t *host = arg;
+    synthHostRealtime(2);
+    unsigned tail = atomic_load_explicit(&host->tail, memory_order_relaxed);
+    while (!atomic_load_explicit(&host->quit, memory_order_relaxed)) {
+        if (tail - atomic_load_explicit(&host->head, memory_order_acquire) >= host->periods) {
+            synthHostSleepUntil(synthHostNow() + synthHostDuration(SYNTH_HOST_PERIOD / 4));
+            continue;
+        }
+        int slot = tail & (SYNTH_HOST_PERIODS - 1);
+        uint64_t start = synthHostNow();
+        if (host->events) {
+            synthEventProcessBlock(host->events, host->synth, host->ring[slot], SYNTH_HOST_PERIOD);
+        } else {
+            synthProcessBlock(host->synth, host->ring[slot], SYNTH_HOST_PERIOD);
+        }
+        uint64_t end = synthHostNow();
+        host->rendered[slot] = end;
+        atomic_store_explicit(&host->tail, ++tail, memory_order_release);
+
+        unsigned us = (end - start) / 1000;
+        atomic_fetch_add_explicit(&host->periodsRendered, 1, memory_order_relaxed);
+        if (us > atomic_load_explicit(&host->renderMax, memory_order_relaxed)) {
+            atomic_store_explicit(&host->renderMax, us, memory_order_relaxed);
+        }
+    }
+    return NULL;
+}
+
+//play a period. returns 0, or 1 if the sink failed. sets xrun if the device reported one
+static int synthHostWrite(SynthHost_t *host, const q15_t *samples, int *xrun) {
+    if (host->sink == SYNTH_HOST_FILE) {
+        //flushed every period, so whatever reads a pipe gets it in time
+        return fwrite(samples, sizeof(q15_t), SYNTH_HOST_PERIOD, host->file) != SYNTH_HOST_PERIOD || fflush(host->file);
+    }
+#if SYNTH_HOST_ALSA
+    if (host->sink == SYNTH_HOST_ALSA_PCM) {
+        int left = SYNTH_HOST_PERIOD;
+        while (left > 0) {
+            snd_pcm_sframes_t frames = snd_pcm_writei(host->pcm, samples, left);
+            if (frames < 0) {
+                *xrun |= frames == -EPIPE;
+                if (snd_pcm_recover(host->pcm, frames, 1)) {
+                    return 1;
+                }
+                continue;
+            }
+            samples += frames;
+            left -= frames;
+        }
+    }
+#else
+    (void) xrun;
+#endif
+    return 0;
+}
+
+//take a period off the ring every SYNTH_HOST_PERIOD samples of wall clock time (or as the device wants them), or
+//play silence if there isn't one
+static void *synthHostSinkThread(void *arg) {
+    SynthHost_t *host = arg;
+    synthHostRealtime(1);
+    //start once the ring has filled up to the latency, like a device starting after its buffer is primed
+    while (!atomic_load_explicit(&host->quit, memory_order_relaxed)
+            && atomic_load_explicit(&host->tail, memory_order_acquire) < host->periods) {
+        synthHostSleepUntil(synthHostNow() + synthHostDuration(SYNTH_HOST_PERIOD / 4));
+    }
+    uint64_t start = synthHostNow();
+    uint64_t played = 0; //samples since start
+    unsigned head = atomic_load_explicit(&host->head, memory_order_relaxed);
+    while (!atomic_load_explicit(&host->quit, memory_order_relaxed)) {
+        int xrun = 0;
+        if (host->sink != SYNTH_HOST_ALSA_PCM) {
+            uint64_t deadline = start + synthHostDuration(played);
+            uint64_t now = synthHostNow();
+            if (now > deadline + synthHostDuration(SYNTH_HOST_PERIOD)) {
+                //too far behind to catch up, carry on from here
+                xrun = 1;
+                start = now;
+                played = 0;
+            } else {
+                synthHostSleepUntil(deadline);
+            }
+            played += SYNTH_HOST_PERIOD;
+        }
+        int underrun = head == atomic_load_explicit(&host->tail, memory_order_acquire);
+        int slot = head & (SYNTH_HOST_PERIODS - 1);
+        uint64_t waited = underrun ? 0 : synthHostNow() - host->rendered[slot];
+        int failed = synthHostWrite(host, underrun ? synthHostSilence : host->ring[slot], &xrun);
+        if (!underrun) {
+            atomic_store_explicit(&host->head, ++head, memory_order_release);
+        }
+
+        atomic_fetch_add_explicit(&host->samples, SYNTH_HOST_PERIOD, memory_order_relaxed);
+        atomic_fetch_add_explicit(&host->underruns, underrun, memory_order_relaxed);
+        atomic_fetch_add_explicit(&host->xruns, xrun, memory_order_relaxed);
+        if (!underrun) {
+            atomic_fetch_add_explicit(&host->latency[synthHostBucket(waited / 1000)], 1, memory_order_relaxed);
+        }
+        atomic_fetch_or_explicit(&host->error, failed, memory_order_relaxed);
+    }
+    return NULL;
+}
+
+static int synthHostOpenSink(SynthHost_t *host, const char *name) {
+    if (host->sink == SYNTH_HOST_FILE) {
+        if (!name) {
+            return 1;
+        }
+        host->file = strcmp(name, "-") ? fopen(name, "wb") : stdout;
+        return !host->file;
+    }
+    if (host->sink == SYNTH_HOST_ALSA_PCM) {
+#if SYNTH_HOST_ALSA
+        if (snd_pcm_open(&host->pcm, name ? name : "default", SND_PCM_STREAM_PLAYBACK, 0)) {
+            return 1;
+        }
+        //the device buffer holds as many periods as the ring is asked to queue
+        unsigned latency = synthHostDuration((uint64_t) host->periods * SYNTH_HOST_PERIOD) / 1000;
+        if (snd_pcm_set_params(host->pcm, SND_PCM_FORMAT_S16, SND_PCM_ACCESS_RW_INTERLEAVED, 1, SAMPLE_RATE, 1, latency)) {
+            snd_pcm_close(host->pcm);
+            return 1;
+        }
+        return 0;
+#else
+        return 1;
+#endif
+    }
+    return 0;
+}
+
+static void synthHostCloseSink(SynthHost_t *host) {
+    if (host->file == stdout) {
+        atomic_fetch_or(&host->error, fflush(stdout) != 0);
+    } else if (host->file) {
+        atomic_fetch_or(&host->error, fclose(host->file) != 0);
+    }
+#if SYNTH_HOST_ALSA
+    if (host->pcm) {
+        snd_pcm_drain(host->pcm);
+        snd_pcm_close(host->pcm);
+    }
+#endif
+}
+
+SynthHost_t *synthHostOpen(Synth_t *synth, SynthEventQueue_t *events, SynthHostSink_t sink, const char *name, int periods) {
+    if (periods < 1 || periods >= SYNTH_HOST_PERIODS) {
+        return NULL;
+    }
+    SynthHost_t *host = calloc(1, sizeof(SynthHost_t));
+    if (!host) {
+        return NULL;
+    }
+    host->synth = synth;
+    host->events = events;
+    host->sink = sink;
+    host->periods = periods;
+    if (synthHostOpenSink(host, name)) {
+        free(host);
+        return NULL;
+    }
+    if (pthread_create(&host->renderThread, NULL, synthHostRenderThread, host)) {
+        synthHostCloseSink(host);
+        free(host);
+        return NULL;
+    }
+    if (pthread_create(&host->sinkThread, NULL, synthHostSinkThread, host)) {
+        atomic_store(&host->quit, 1);
+        pthread_join(host->renderThread, NULL);
+        synthHostCloseSink(host);
+        free(host);
+        return NULL;
+    }
+    return host;
+}
+
+void synthHostStats(SynthHost_t *host, SynthHostStats_t *stats) {
+    stats->samples = atomic_load_explicit(&host->samples, memory_order_relaxed);
+    stats->periods = atomic_load_explicit(&host->periodsRendered, memory_order_relaxed);
+    stats->underruns = atomic_load_explicit(&host->underruns, memory_order_relaxed);
+    stats->xruns = atomic_load_explicit(&host->xruns, memory_order_relaxed);
+    stats->renderMax = atomic_load_explicit(&host->renderMax, memory_order_relaxed);
+    for (int k = 0; k < SYNTH_HOST_HISTOGRAM; k++) {
+        stats->latency[k] = atomic_load_explicit(&host->latency[k], memory_order_relaxed);
+    }
+}
+
+int synthHostClose(SynthHost_t *host) {
+    atomic_store(&host->quit, 1);
+    pthread_join(host->renderThread, NULL);
+    pthread_join(host->sinkThread, NULL);
+    synthHostCloseSink(host);
+    int res = atomic_load(&host->error);
+    free(host);
+    return res;
+}
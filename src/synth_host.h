@@ -0,0 +1,59 @@
+//host only: real time playback, for soak testing and latency profiling the engine on a host the way it runs on the device.
+//a render thread keeps a lock free ring of periods topped up with synthProcessBlock, and a sink thread takes a period
+//at a time at the sample rate, like the audio interrupt would, counting underruns and how long each period waited.
+//once playing, the render thread owns the synth, so change it through an event queue (see synth_events.h)
+#ifndef __SYNTH_HOST_H
+#define __SYNTH_HOST_H
+
+#include "synth.h"
+#include "synth_events.h"
+
+//samples the sink takes at a time, like a DMA half buffer on the device
+#ifndef SYNTH_HOST_PERIOD
+#define SYNTH_HOST_PERIOD 256
+#endif
+
+//periods the ring holds, must be a power of 2. how many are queued before playing is set when opening
+#ifndef SYNTH_HOST_PERIODS
+#define SYNTH_HOST_PERIODS 16
+#endif
+
+//build with -DSYNTH_HOST_ALSA=1 and -lasound for the alsa sink
+#ifndef SYNTH_HOST_ALSA
+#define SYNTH_HOST_ALSA 0
+#endif
+
+//latency histogram buckets, bucket k counts periods that waited 2^k to 2^(k+1) us, the last one anything longer
+#define SYNTH_HOST_HISTOGRAM 24
+
+typedef enum SynthHostSink {
+    SYNTH_HOST_NULL, //throws the samples away, but takes them at the sample rate
+    SYNTH_HOST_FILE, //headerless 16 bit mono pcm in host byte order to a file, named pipe, or stdout ("-"), at the sample rate
+    SYNTH_HOST_ALSA_PCM, //an alsa device ("default" if the name is NULL), which sets the pace itself
+} SynthHostSink_t;
+
+typedef struct SynthHostStats {
+    uint64_t samples; //played by the sink, including silence for underruns
+    uint32_t periods; //rendered
+    uint32_t underruns; //periods the ring was empty for when the sink needed one, played as silence
+    uint32_t xruns; //times the sink fell more than a period behind (the alsa device's own xruns for alsa)
+    uint32_t renderMax; //longest a period took to render, in us
+    uint32_t latency[SYNTH_HOST_HISTOGRAM]; //how long played periods waited between being rendered and played
+} SynthHostStats_t;
+
+typedef struct SynthHost SynthHost_t;
+
+//start playing synth to a sink, queueing up to periods periods (1 to SYNTH_HOST_PERIODS - 1) ahead of it, which
+//is the latency. with events set, they're applied on the exact samples as the render thread gets to them
+//(synthEventProcessBlock). the threads ask for real time scheduling, and run at normal priority if they can't
+//get it. returns NULL if the sink or threads can't be started, including a file sink without a name
+SynthHost_t *synthHostOpen(Synth_t *synth, SynthEventQueue_t *events, SynthHostSink_t sink, const char *name, int periods);
+
+//copy of the counters so far, can be called while playing. the threads don't wait on it, so while playing the counters
+//are read one at a time and can be a period apart from each other
+void synthHostStats(SynthHost_t *host, SynthHostStats_t *stats);
+
+//stop playing and close the sink. returns 0 if everything was written
+int synthHostClose(SynthHost_t *host);
+
+#endif // __SYNTH_HOST_H
@@ -0,0 +1,367 @@
+//inline versions of the per sample kernels
+//shared by synth.c and compiled patches (see synth_static.h) so the compiler can inline them into render loops
+#ifndef __SYNTH_INLINE_H
+#define __SYNTH_INLINE_H
+
+#include "synth.h"
+
+#if SYNTH_SINE_LUT_8BIT
+extern const q7_t sineLut[128 + 1];
+#else
+extern const q15_t sineLut16[256 + 1];
+#endif
+
+
+//oscillator phase helpers, for 15 or 32 bit phase (see SYNTH_PHASE_32)
+
+//phase as a wavegen input, between 0 and Q15_MAX
+static inline q15_t synthPhaseWave(int32_t state) {
+#if SYNTH_PHASE_32
+    return (uint32_t) state >> 17;
+#else
+    return state & 0x7FFF;
+#endif
+}
+
+//advance the phase by an increment, plus a detune in 15 bit phase units
+static inline int32_t synthPhaseStep(int32_t state, SynthPhase_t increment, int32_t detune) {
+#if SYNTH_PHASE_32
+    return (uint32_t) state + increment + (uint32_t) detune * (1 << 17);
+#else
+    return (state + increment + detune) & 0x7FFF;
+#endif
+}
+
+//phase increment in 15 bit phase units, for the band limited wavegens
+static inline q15_t synthPhaseIncrement15(SynthPhase_t increment) {
+#if SYNTH_PHASE_32
+    return (int32_t) increment >> 17;
+#else
+    return increment;
+#endif
+}
+
+//move a gliding voice's pitch on by a sample, before its nodes run
+static inline void synthVoiceGlideStep(SynthVoice_t *voice) {
+    if (voice->glideLeft) {
+        voice->glideAt += voice->glideStep;
+        voice->phaseIncrement = --voice->glideLeft ? (SynthPhase_t) (voice->glideAt >> SYNTH_GLIDE_SHIFT) : voice->glideTarget;
+    }
+}
+
+
+//these wave generator functions all take a basic ramping sawtooth between 0 and 1 as input
+//and return a waveform between -1 and 1
+
+static inline q15_t sawtoothWaveInline(q15_t input) {
+    return input * 2 - Q15_MAX;
+}
+
+static inline q15_t sineWaveInline(q15_t input) {
+#if SYNTH_SINE_LUT_8BIT
+    int index = (input >> 8) & 0x7F;
+    q15_t res = sineLut[index] * 258; //multiply by 258 to get full range
+#if SYNTH_INTERPOLATE
+    q15_t next = sineLut[index + 1] * 258;
+    res += ((next - res) * (input & 0xFF) >> 8);
+#endif
+
+#else //16 bit
+    int index = (input >> 7) & 0xFF;
+    q15_t res = sineLut16[index];
+#if SYNTH_INTERPOLATE
+    q15_t next = sineLut16[index + 1];
+    res += ((next - res) * (input & 0x7F) >> 7);
+#endif
+
+#endif //16
+    return res;
+}
+
+static inline q15_t squareWaveInline(q15_t input) {
+    return input < Q15_MAX/2 ? Q15_MAX : Q15_MIN;
+}
+
+static inline q15_t triangleWaveInline(q15_t input) {
+    int32_t res = input<<1;
+    if (res > Q15_MAX) {
+        res = Q15_MAX - (res - Q15_MAX);
+    }
+    return res*2 - Q15_MAX;
+}
+
+//sawtooth wave falling
+static inline q15_t fallingWaveInline(q15_t input) {
+    return Q15_MAX - input*2;
+}
+
+//exponentially decaying
+static inline q15_t expDecayWaveInline(q15_t input) {
+    //invert input so that it decays
+    input = (Q15_MAX - input);
+    input = (input * input) >> 15;
+    input = (input * input) >> 15;
+    return input;
+}
+
+
+//band limited wave generators also take the phase increment, and smooth out the jumps in the naive waveforms
+//with a polyBLEP (polynomial band limited step) over the sample either side of each jump.
+//that keeps most of the harmonics above nyquist from aliasing back down, without extra filter nodes.
+//costs a compare per jump, and a divide and a couple of multiplies for the 2 samples next to each jump
+
+//polyBLEP residual for a jump from 1 down to -1 at phase 0, for a phase increment of dt
+static inline int32_t synthPolyBlep(int32_t t, int32_t dt) {
+    if (dt < 0) {
+        dt = -dt;
+    }
+    if (t < dt) {
+        //just after the jump
+        int32_t x = (t << 15) / dt;
+        return 2 * x - ((x * x) >> 15) - 0x8000;
+    }
+    if (t > 0x8000 - dt) {
+        //just before the jump
+        int32_t x = -(((0x8000 - t) << 15) / dt);
+        return ((x * x) >> 15) + 2 * x + 0x8000;
+    }
+    return 0;
+}
+
+static inline q15_t synthClampQ15(int32_t value) {
+    if (value > Q15_MAX) {
+        return Q15_MAX;
+    }
+    if (value < -Q15_MAX) {
+        return -Q15_MAX;
+    }
+    return value;
+}
+
+static inline q15_t sawtoothWaveBlInline(q15_t input, q15_t increment) {
+    return synthClampQ15(input * 2 - Q15_MAX - synthPolyBlep(input, increment));
+}
+
+//pulse wave, high while the phase is below width. jumps up at phase 0 and down at width
+static inline q15_t synthPulseBl(q15_t input, q15_t increment, q15_t width) {
+    int32_t res = input < width ? Q15_MAX : -Q15_MAX;
+    res += synthPolyBlep(input, increment);
+    res -= synthPolyBlep((input - width) & 0x7FFF, increment);
+    return synthClampQ15(res);
+}
+
+static inline q15_t squareWaveBlInline(q15_t input, q15_t increment) {
+    return synthPulseBl(input, increment, 0x4000);
+}
+
+//25% duty cycle
+static inline q15_t pulseWaveBlInline(q15_t input, q15_t increment) {
+    return synthPulseBl(input, increment, 0x2000);
+}
+
+
+//wavetables
+
+//one frame's sample at phase, interpolated between its neighbors (wrapping around the end of the frame)
+static inline int32_t synthWavetableFrame(const q15_t *frame, q15_t phase, int bits) {
+    int shift = 15 - bits;
+    int index = phase >> shift;
+    int32_t res = frame[index];
+#if SYNTH_INTERPOLATE
+    int32_t next = frame[(index + 1) & ((1 << bits) - 1)];
+    res += ((next - res) * (phase & ((1 << shift) - 1))) >> shift;
+#endif
+    return res;
+}
+
+//a wavetable's output at phase, crossfading between the frames either side of position (0 to Q15_MAX across the bank)
+static inline q15_t synthWavetableLookup(const SynthWavetable_t *table, q15_t phase, q15_t position) {
+    int bits = table->bits;
+    int32_t framePosition = position > 0 ? position * (table->frameCount - 1) : 0;
+    const q15_t *frame = table->samples + ((framePosition >> 15) << bits);
+    int32_t blend = framePosition & 0x7FFF;
+    int32_t res = synthWavetableFrame(frame, phase, bits);
+    if (blend) {
+        int32_t other = synthWavetableFrame(frame + (1 << bits), phase, bits);
+        res += ((other - res) * blend) >> 15;
+    }
+    return res;
+}
+
+
+//state variable filter (Chamberlin). the state is kept within +-SYNTH_SVF_LIMIT, so every product fits in 32 bits
+//however hard it resonates. cutoff is f in q15, damping is 1/Q in q14, from sqrt(2) (no resonance) down to 1/128.
+//with f below 1 that keeps it stable everywhere
+#define SYNTH_SVF_LIMIT 0xFFFF
+#define SYNTH_SVF_DAMPING_MAX 23170
+#define SYNTH_SVF_DAMPING_MIN 128
+
+static inline int32_t synthSvfClamp(int32_t value) {
+    if (value > SYNTH_SVF_LIMIT) {
+        return SYNTH_SVF_LIMIT;
+    }
+    if (value < -SYNTH_SVF_LIMIT) {
+        return -SYNTH_SVF_LIMIT;
+    }
+    return value;
+}
+
+static inline int32_t synthSvfCutoff(q15_t cutoff) {
+    return cutoff > 0 ? cutoff : 0;
+}
+
+static inline int32_t synthSvfDamping(q15_t resonance) {
+    int32_t r = resonance > 0 ? resonance : 0;
+    return SYNTH_SVF_DAMPING_MAX - ((r * (SYNTH_SVF_DAMPING_MAX - SYNTH_SVF_DAMPING_MIN)) >> 15);
+}
+
+//one sample of the filter, outputs gets every response indexed by SynthSvfOutput_t (not yet clamped to q15)
+static inline void synthSvfStep(int32_t *low, int32_t *band, int32_t input, int32_t cutoff, int32_t damping, int32_t *outputs) {
+    int32_t l = synthSvfClamp(*low + ((cutoff * *band) >> 15));
+    int32_t h = synthSvfClamp(input - l - ((damping * *band) >> 14));
+    int32_t b = synthSvfClamp(*band + ((cutoff * h) >> 15));
+    *low = l;
+    *band = b;
+    outputs[SYNTH_SVF_LP] = l;
+    outputs[SYNTH_SVF_HP] = h;
+    outputs[SYNTH_SVF_BP] = b;
+    outputs[SYNTH_SVF_NOTCH] = h + l;
+}
+
+
+//white noise: xorshift32, which goes through every nonzero 32 bit state before repeating.
+//the top bits are the most random, so those are the output
+#define SYNTH_NOISE_SEED 0x12345678
+
+static inline uint32_t synthNoiseStep(uint32_t state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static inline q15_t synthNoiseOutput(uint32_t state) {
+    return (int32_t) state >> 16;
+}
+
+//fill out with n samples, returns the state after them
+static inline uint32_t synthNoiseBlock(uint32_t state, q15_t *out, int n) {
+    for (int t = 0; t < n; t++) {
+        out[t] = synthNoiseOutput(state);
+        state = synthNoiseStep(state);
+    }
+    return state;
+}
+
+
+//run a delay line for a sample: read back time (0 to Q15_MAX of the line, at least 1 sample) interpolating between
+//samples, then write input plus feedback times what was read. quiet counts the silent samples written in a row, up to
+//the line's length. returns what was read
+static inline int32_t synthDelayStep(SynthDelay_t *delay, int32_t *quiet, int32_t input, int32_t time, int32_t feedback) {
+    uint32_t mask = delay->mask;
+    uint32_t back = (uint32_t) (time < 0 ? 0 : time) * (mask + 1) >> 7; //samples with 8 fraction bits
+    if (back < 256) {
+        back = 256;
+    }
+    uint32_t pos = delay->pos;
+    int32_t a = delay->line[(pos - (back >> 8)) & mask];
+    int32_t b = delay->line[(pos - (back >> 8) - 1) & mask];
+    int32_t res = a + (((b - a) * (int32_t) (back & 0xFF)) >> 8);
+    //rounded toward 0, so a loop dies away instead of getting stuck at -1
+    int32_t fed = res * feedback;
+    fed = (fed + (fed < 0 ? 0x7FFF : 0)) >> 15;
+    q15_t write = synthClampQ15(input + fed);
+    delay->line[pos] = write;
+    delay->pos = (pos + 1) & mask;
+    if (write) {
+        *quiet = 0;
+    } else if ((uint32_t) *quiet <= mask) {
+        (*quiet)++;
+    }
+    return res;
+}
+
+//soft clipper. close to linear up to 50% of q15, then smooths out, reaching full scale at 2x q15 (the sine's quarter
+//cycle). the polynomial is x(a + bx^2 + cx^4) with a slope of pi/2 at 0 like the sine, and 1 with a slope of 0 at the top
+#define SYNTH_CLIPPER_A 51472 //pi/2 in q15
+#define SYNTH_CLIPPER_B -21025
+#define SYNTH_CLIPPER_C 2320
+
+static inline q15_t softClipperInline(int32_t input) {
+#if SYNTH_CLIPPER_POLY
+    int32_t x = input > 0 ? input : -input;
+    x >>= 1;
+    if (x >= Q15_MAX) {
+        return input > 0 ? Q15_MAX : -Q15_MAX;
+    }
+    int32_t x2 = (x * x) >> 15;
+    int32_t p = SYNTH_CLIPPER_B + ((SYNTH_CLIPPER_C * x2) >> 15);
+    p = SYNTH_CLIPPER_A + ((p * x2) >> 15);
+    int32_t res = (x * p) >> 15;
+    if (res > Q15_MAX) {
+        res = Q15_MAX;
+    }
+    return input > 0 ? res : -res;
+#else
+    //use the first quadrant of a sine wave as a compressor
+    int sign = input < 0 ? -1 : 1;
+    input = input > 0 ? input : -input;
+    int32_t a = input >> 3; //divide by 8, a 50% vallue will end up around 70%, while higher values will be compressed with the top of the sine wave
+    //clip to a quadrant
+    if (a > Q15_MAX/4) {
+        // __asm("BKPT #0\n");
+        a = Q15_MAX/4;
+    }
+    q15_t res = sineWaveInline(a);
+    res = (res * sign);      
+    return res;
+#endif
+}
+
+
+//envelope output for a given state
+static inline int32_t synthEnvelopeOutput(int32_t state, q15_t sustain) {
+    int32_t res = (state & 0x7FFFFF) >> 4;
+    res = (res * res) >> 15; //square the envelope
+    //if sustain is negative, this is a negative envelope, so invert the output
+    if (sustain < 0) {
+        res = -res;
+    }
+    return res;
+}
+
+//advance an envelope by one sample, returns the new state
+//(rates are wider than q15 so control rate envelopes can step several samples at once)
+static inline int32_t synthEnvelopeStep(int32_t state, int gate, int32_t attack, int32_t decay, q15_t sustain, int32_t release) {
+    //the top bit of state is reserved for the decay mode (after attack)
+    if (gate) { //while gate is on, do attack, then decay
+        int modeBit = state & 0x80000000;
+        int32_t value = state & 0x7FFFFFFF;
+        if (modeBit) {
+            //decay
+            value -= decay;
+            const q15_t sustainAbs = sustain < 0 ? -sustain : sustain;
+            if (value < sustainAbs << 4) {
+                value = sustainAbs << 4;
+            }
+        } else {
+            //attack
+            value += attack;
+            if (value > (int32_t)Q15_MAX << 4) {
+                value = (int32_t)Q15_MAX << 4;
+                modeBit = 0x80000000; //switch to decay
+            }
+        }
+        state = value | modeBit;
+    } else { //when gate is off, do release
+        //clear the modeBit (if set), so the next gate on will start with attack
+        state &= 0x7FFFFFFF;
+        state -= release;
+        if (state < 0) {
+            state = 0;
+        }
+    }
+    return state;
+}
+
+#endif // __SYNTH_INLINE_H
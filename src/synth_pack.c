@@ -0,0 +1,441 @@
+//voice packs, see synth_pack.h
+
+#include "synth_pack.h"
+#include "synth_inline.h"
+#include "synth_simd.h"
+#include "string.h"
+
+//what NULL inputs read, except gains and mixer inputs, which skip them
+static const q15_t synthPackZero = 0;
+
+//the order state rows are laid out in, so each type's state sits together
+static const uint8_t synthPackStateTypes[] = {
+    SYNTH_NODE_OSCILLATOR, SYNTH_NODE_OSCILLATOR_BL, SYNTH_NODE_WAVETABLE, SYNTH_NODE_ENVELOPE,
+    SYNTH_NODE_FILTER_LP, SYNTH_NODE_FILTER_HP, SYNTH_NODE_FILTER_SVF, SYNTH_NODE_NOISE,
+};
+
+//where node reader of voice reads p from, as a row or a value every voice shares. 0 if a pack can't provide it
+static int synthPackResolve(const SynthVoice_t *voice, int reader, const q15_t *p, SynthPackInput_t *input) {
+    input->ptr = p;
+    input->row = -1;
+    input->step = 0;
+    if (!p) {
+        return 1;
+    }
+    uintptr_t addr = (uintptr_t) p;
+    uintptr_t nodesStart = (uintptr_t) voice->nodes;
+    if (addr >= nodesStart && addr < nodesStart + voice->nodeCapacity * sizeof(SynthNode_t)) {
+        int j = (addr - nodesStart) / sizeof(SynthNode_t);
+        const SynthNode_t *node = &voice->nodes[j];
+        //a node runs over the whole block at once, so it can't see its own output as it goes
+        if (j == reader || j >= voice->nodeCount) {
+            return 0;
+        }
+        input->step = 1;
+        if (p == &node->output) {
+            input->row = j;
+            return 1;
+        }
+        if (node->type == SYNTH_NODE_FILTER_SVF && p >= node->svf.outputs && p < node->svf.outputs + 4) {
+            int tap = j << 2 | (p - node->svf.outputs);
+            for (int k = 0; k < voice->tapCount; k++) {
+                if (voice->taps[k] == tap) {
+                    input->row = voice->nodeCount + k;
+                    return 1;
+                }
+            }
+        }
+        return 0;
+    }
+    //only phaseIncrement is taken from the voice, as each pack voice's note
+    return addr < (uintptr_t) voice || addr >= (uintptr_t) (voice + 1);
+}
+
+static int synthPackResolveIncrement(const SynthVoice_t *voice, int reader, const SynthPhase_t *p, SynthPackNode_t *node) {
+    if (p == &voice->phaseIncrement) {
+        node->incrementFrom = SYNTH_PACK_INCREMENT_VOICE;
+        return 1;
+    }
+    //a node output can only be a phase increment with 15 bit phase
+    if (!synthPackResolve(voice, reader, (const q15_t *) p, &node->inputs[2]) || (node->inputs[2].step && sizeof(SynthPhase_t) != sizeof(q15_t))) {
+        return 0;
+    }
+    //kept in the spare input until the rows are placed
+    node->increment = p;
+    node->incrementFrom = node->inputs[2].step ? SYNTH_PACK_INCREMENT_ROW : SYNTH_PACK_INCREMENT_SHARED;
+    return 1;
+}
+
+//work out the pack's view of voice's patch, 0 if it can't be packed
+static int synthPackPlan(SynthVoice_t *voice, SynthPackNode_t *plan) {
+    memset(plan, 0, SYNTH_NODES * sizeof(SynthPackNode_t));
+    synthVoiceSchedule(voice);
+    if (voice->linked || voice->feedback || voice->tapOverflow || voice->oversample || voice->glide || voice->legato
+            || voice->nodeCount == 0 || voice->outputNode >= voice->nodeCount) {
+        return 0;
+    }
+    for (int j = 0; j < voice->nodeCount; j++) {
+        const SynthNode_t *node = &voice->nodes[j];
+        SynthPackNode_t *p = &plan[j];
+        if (node->rate) {
+            return 0;
+        }
+        p->type = node->type;
+        p->retrigger = node->retrigger;
+        int ok = synthPackResolve(voice, j, node->gain, &p->gain);
+        switch (node->type) {
+            case SYNTH_NODE_OSCILLATOR:
+            case SYNTH_NODE_OSCILLATOR_BL:
+            case SYNTH_NODE_WAVETABLE:
+                ok &= synthPackResolveIncrement(voice, j, node->osc.phaseIncrement, p);
+                ok &= synthPackResolve(voice, j, node->osc.detune, &p->inputs[0]);
+                if (node->type == SYNTH_NODE_OSCILLATOR) {
+                    p->wavegen = node->osc.wavegen;
+                } else if (node->type == SYNTH_NODE_OSCILLATOR_BL) {
+                    p->wavegenBl = node->osc.wavegenBl;
+                } else {
+                    p->table = node->osc.table;
+                    ok &= synthPackResolve(voice, j, node->osc.position, &p->inputs[1]);
+                }
+                break;
+            case SYNTH_NODE_ENVELOPE:
+                p->env = node->env;
+                break;
+            case SYNTH_NODE_FILTER_LP:
+            case SYNTH_NODE_FILTER_HP:
+                ok &= synthPackResolve(voice, j, node->filter.input, &p->inputs[0]);
+                p->factor = node->filter.factor;
+                break;
+            case SYNTH_NODE_MIXER:
+                for (int k = 0; k < 3; k++) {
+                    ok &= synthPackResolve(voice, j, node->mixer.inputs[k], &p->inputs[k]);
+                }
+                break;
+            case SYNTH_NODE_FILTER_SVF:
+                ok &= synthPackResolve(voice, j, node->svf.input, &p->inputs[0]);
+                ok &= synthPackResolve(voice, j, node->svf.cutoff, &p->inputs[1]);
+                ok &= synthPackResolve(voice, j, node->svf.resonance, &p->inputs[2]);
+                p->mode = node->svf.mode;
+                break;
+            case SYNTH_NODE_NOISE:
+                break;
+            default:
+                //delays need a line for every voice
+                return 0;
+        }
+        if (!ok) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void synthPackPlace(SynthPack_t *pack, SynthPackInput_t *input) {
+    if (input->row >= 0) {
+        input->ptr = pack->outputs + input->row * SYNTH_PACK_BLOCK * pack->voiceCount;
+    }
+}
+
+int synthPackInit(SynthPack_t *pack, Synth_t *synth, SynthVoice_t *voice, int voiceCount) {
+    memset(pack, 0, sizeof(SynthPack_t));
+    SynthPackNode_t plan[SYNTH_NODES];
+    if (voiceCount < 1 || voiceCount > SYNTH_PACK_VOICES || !synthPackPlan(voice, plan)) {
+        return -1;
+    }
+    int nodeCount = voice->nodeCount;
+    int rowOf[SYNTH_NODES];
+    int rows = 0;
+    for (size_t k = 0; k < sizeof(synthPackStateTypes); k++) {
+        for (int j = 0; j < nodeCount; j++) {
+            if (plan[j].type == synthPackStateTypes[k]) {
+                rowOf[j] = rows;
+                rows += plan[j].type == SYNTH_NODE_FILTER_SVF ? 2 : 1;
+            }
+        }
+    }
+    //check there's room for all of it first, so a pack that doesn't fit doesn't use up the arena
+    size_t outputSize = (size_t) (nodeCount + voice->tapCount) * SYNTH_PACK_BLOCK * voiceCount * sizeof(q15_t);
+    size_t size = SYNTH_ARENA_ROUND(nodeCount * sizeof(SynthPackNode_t)) + SYNTH_ARENA_ROUND(3 * voiceCount)
+            + SYNTH_ARENA_ROUND(voiceCount * sizeof(SynthPhase_t)) + SYNTH_ARENA_ROUND((size_t) rows * voiceCount * sizeof(int32_t))
+            + SYNTH_ARENA_ROUND(outputSize);
+    if (size > synth->arenaSize - synth->arenaUsed) {
+        return -1;
+    }
+    pack->synth = synth;
+    pack->voiceCount = voiceCount;
+    pack->nodeCount = nodeCount;
+    pack->outputNode = voice->outputNode;
+    memcpy(pack->order, voice->order, sizeof(pack->order));
+    pack->nodes = synthArenaAlloc(synth, nodeCount * sizeof(SynthPackNode_t));
+    pack->lanes = synthArenaAlloc(synth, 3 * voiceCount);
+    pack->voices = pack->lanes + voiceCount;
+    pack->gate = pack->voices + voiceCount;
+    pack->increment = synthArenaAlloc(synth, voiceCount * sizeof(SynthPhase_t));
+    pack->state = synthArenaAlloc(synth, (size_t) rows * voiceCount * sizeof(int32_t));
+    pack->stateRows = rows;
+    pack->outputs = synthArenaAlloc(synth, outputSize);
+
+    memcpy(pack->nodes, plan, nodeCount * sizeof(SynthPackNode_t));
+    for (int k = 0; k < voice->tapCount; k++) {
+        int j = voice->taps[k] >> 2;
+        pack->nodes[j].taps[voice->taps[k] & 3] = pack->outputs + (nodeCount + k) * SYNTH_PACK_BLOCK * voiceCount;
+    }
+    for (int j = 0; j < nodeCount; j++) {
+        SynthPackNode_t *node = &pack->nodes[j];
+        const SynthNode_t *from = &voice->nodes[j];
+        synthPackPlace(pack, &node->gain);
+        for (int k = 0; k < 3; k++) {
+            synthPackPlace(pack, &node->inputs[k]);
+        }
+        if (node->incrementFrom == SYNTH_PACK_INCREMENT_ROW) {
+            node->increment = (const SynthPhase_t *) node->inputs[2].ptr;
+        }
+        if (node->type == SYNTH_NODE_MIXER) {
+            continue;
+        }
+        //every voice starts where voice's node is now
+        node->state = pack->state + rowOf[j] * voiceCount;
+        for (int v = 0; v < voiceCount; v++) {
+            if (node->type == SYNTH_NODE_FILTER_LP || node->type == SYNTH_NODE_FILTER_HP) {
+                node->state[v] = from->filter.accum;
+            } else if (node->type == SYNTH_NODE_FILTER_SVF) {
+                node->state[v] = from->svf.low;
+                node->state[voiceCount + v] = from->svf.band;
+            } else {
+                node->state[v] = from->state;
+            }
+        }
+    }
+    //like a freshly wired voice, every voice runs until it's found to be idle
+    for (int v = 0; v < voiceCount; v++) {
+        pack->lanes[v] = v;
+        pack->voices[v] = v;
+        pack->increment[v] = voice->phaseIncrement;
+    }
+    pack->active = voiceCount;
+    return 0;
+}
+
+static void synthPackSwap(SynthPack_t *pack, int a, int b) {
+    if (a == b) {
+        return;
+    }
+    for (int r = 0; r < pack->stateRows; r++) {
+        int32_t *row = pack->state + r * pack->voiceCount;
+        int32_t state = row[a];
+        row[a] = row[b];
+        row[b] = state;
+    }
+    uint8_t gate = pack->gate[a];
+    pack->gate[a] = pack->gate[b];
+    pack->gate[b] = gate;
+    SynthPhase_t increment = pack->increment[a];
+    pack->increment[a] = pack->increment[b];
+    pack->increment[b] = increment;
+    uint8_t voice = pack->voices[a];
+    pack->voices[a] = pack->voices[b];
+    pack->voices[b] = voice;
+    pack->lanes[pack->voices[a]] = a;
+    pack->lanes[pack->voices[b]] = b;
+}
+
+void synthPackNoteOn(SynthPack_t *pack, int voice, uint8_t note) {
+    int l = pack->lanes[voice];
+    if (l >= pack->active) {
+        //back into the playing lanes
+        synthPackSwap(pack, l, pack->active);
+        l = pack->active++;
+    }
+    pack->gate[l] = 1;
+    pack->increment[l] = midiToPhaseIncr(note);
+    for (int j = 0; j < pack->nodeCount; j++) {
+        SynthPackNode_t *node = &pack->nodes[j];
+        if (node->retrigger == SYNTH_RETRIGGER_FREE) {
+            continue;
+        }
+        if (node->type == SYNTH_NODE_ENVELOPE) {
+            node->state[l] = node->retrigger == SYNTH_RETRIGGER_LEVEL ? node->state[l] & 0x7FFFFFFF : 0;
+        } else if (node->type == SYNTH_NODE_OSCILLATOR || node->type == SYNTH_NODE_OSCILLATOR_BL || node->type == SYNTH_NODE_WAVETABLE) {
+            node->state[l] = 0;
+        }
+    }
+}
+
+void synthPackNoteOff(SynthPack_t *pack, int voice) {
+    pack->gate[pack->lanes[voice]] = 0;
+}
+
+//an input as a row (step 1) or shared value (step 0), NULL reading 0
+static inline const q15_t *synthPackRow(const SynthPackInput_t *input, int *step) {
+    *step = input->step;
+    return input->ptr ? input->ptr : &synthPackZero;
+}
+
+//run a node over n samples of the first lanes lanes. nodes only read nodes that ran before them, so each one runs
+//the whole block at once. rows hold lanes values for each sample, so e = t * lanes + l
+static void synthPackNode(SynthPack_t *pack, const SynthPackNode_t *node, q15_t *out, int n, int lanes) {
+    int32_t *state = node->state;
+    const q15_t *gain = node->gain.ptr;
+    int gainStep = node->gain.step;
+    int size = n * lanes;
+    int s0, s1, s2;
+    switch (node->type) {
+        case SYNTH_NODE_OSCILLATOR:
+        case SYNTH_NODE_OSCILLATOR_BL:
+        case SYNTH_NODE_WAVETABLE: {
+            //phases for the whole block first, then the waveform and gain run over all of it at once
+            q15_t phase[SYNTH_PACK_BLOCK * SYNTH_PACK_VOICES];
+            q15_t increment15[SYNTH_PACK_BLOCK * SYNTH_PACK_VOICES];
+            const q15_t *detune = synthPackRow(&node->inputs[0], &s0);
+            //each lane's note, a row, or a shared value
+            const SynthPhase_t *increment = node->incrementFrom == SYNTH_PACK_INCREMENT_VOICE ? pack->increment : node->increment;
+            int incrementStep = node->incrementFrom == SYNTH_PACK_INCREMENT_ROW ? lanes : 0;
+            int incrementLane = node->incrementFrom != SYNTH_PACK_INCREMENT_SHARED;
+            for (int t = 0, e = 0; t < n; t++) {
+                for (int l = 0; l < lanes; l++, e++) {
+                    SynthPhase_t inc = increment[t * incrementStep + l * incrementLane];
+                    phase[e] = synthPhaseWave(state[l]);
+                    increment15[e] = synthPhaseIncrement15(inc) + detune[e * s0];
+                    state[l] = synthPhaseStep(state[l], inc, detune[e * s0]);
+                }
+            }
+            if (node->type == SYNTH_NODE_OSCILLATOR_BL) {
+                for (int e = 0; e < size; e++) {
+                    out[e] = node->wavegenBl(phase[e], increment15[e]);
+                }
+            } else if (node->type == SYNTH_NODE_WAVETABLE) {
+                const q15_t *position = synthPackRow(&node->inputs[1], &s1);
+                //a copy, so the bank doesn't have to be read again after every store to out
+                const SynthWavetable_t table = *node->table;
+                for (int e = 0; e < size; e++) {
+                    out[e] = synthWavetableLookup(&table, phase[e], position[e * s1]);
+                }
+            } else if (!synthWaveBlock(node->wavegen, phase, out, size)) {
+                for (int e = 0; e < size; e++) {
+                    out[e] = node->wavegen(phase[e]);
+                }
+            }
+            if (gain) {
+                synthGainBlock(out, gain, gainStep, size);
+            }
+            break;
+        }
+        case SYNTH_NODE_ENVELOPE: {
+            const SynthEnvelope_t env = node->env;
+            const uint8_t *gate = pack->gate;
+            for (int t = 0, e = 0; t < n; t++) {
+                for (int l = 0; l < lanes; l++, e++) {
+                    int32_t output = synthEnvelopeOutput(state[l], env.sustain);
+                    out[e] = gain ? (output * gain[e * gainStep]) >> 15 : output;
+                    state[l] = synthEnvelopeStep(state[l], gate[l], env.attack, env.decay, env.sustain, env.release);
+                }
+            }
+            break;
+        }
+        case SYNTH_NODE_FILTER_LP:
+        case SYNTH_NODE_FILTER_HP: {
+            const q15_t *input = synthPackRow(&node->inputs[0], &s0);
+            int32_t factor = node->factor;
+            int hp = node->type == SYNTH_NODE_FILTER_HP;
+            for (int t = 0, e = 0; t < n; t++) {
+                for (int l = 0; l < lanes; l++, e++) {
+                    int32_t output = (state[l] * factor) >> 15;
+                    if (hp) {
+                        output = input[e * s0] - output;
+                    }
+                    out[e] = gain ? (output * gain[e * gainStep]) >> 15 : output;
+                    state[l] += input[e * s0] - out[e];
+                }
+            }
+            break;
+        }
+        case SYNTH_NODE_MIXER: {
+            const q15_t *inputs[3] = {node->inputs[0].ptr, node->inputs[1].ptr, node->inputs[2].ptr};
+            int steps[3] = {node->inputs[0].step, node->inputs[1].step, node->inputs[2].step};
+            synthMixBlock(out, inputs, steps, gain, gainStep, size);
+            break;
+        }
+        case SYNTH_NODE_NOISE:
+            for (int t = 0, e = 0; t < n; t++) {
+                for (int l = 0; l < lanes; l++, e++) {
+                    int32_t output = synthNoiseOutput(state[l]);
+                    out[e] = gain ? (output * gain[e * gainStep]) >> 15 : output;
+                    state[l] = synthNoiseStep(state[l]);
+                }
+            }
+            break;
+        case SYNTH_NODE_FILTER_SVF: {
+            const q15_t *input = synthPackRow(&node->inputs[0], &s0);
+            const q15_t *cutoff = synthPackRow(&node->inputs[1], &s1);
+            const q15_t *resonance = synthPackRow(&node->inputs[2], &s2);
+            int32_t *band = state + pack->voiceCount;
+            for (int t = 0, e = 0; t < n; t++) {
+                for (int l = 0; l < lanes; l++, e++) {
+                    int32_t outputs[4];
+                    synthSvfStep(&state[l], &band[l], input[e * s0], synthSvfCutoff(cutoff[e * s1]), synthSvfDamping(resonance[e * s2]), outputs);
+                    for (int k = 0; k < 4; k++) {
+                        if (node->taps[k]) {
+                            int32_t response = synthClampQ15(outputs[k]);
+                            node->taps[k][e] = gain ? (response * gain[e * gainStep]) >> 15 : response;
+                        }
+                    }
+                    int32_t output = synthClampQ15(outputs[node->mode]);
+                    out[e] = gain ? (output * gain[e * gainStep]) >> 15 : output;
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+//like synthVoiceCheckIdle for each released lane, moving voices that have gone quiet out of the playing lanes.
+//goes from the top, so a lane swapped down has already been checked
+static void synthPackCheckIdle(SynthPack_t *pack, int n, int lanes) {
+    int last = (n - 1) * lanes;
+    for (int l = lanes - 1; l >= 0; l--) {
+        if (pack->gate[l] || pack->outputs[pack->outputNode * SYNTH_PACK_BLOCK * pack->voiceCount + last + l] != 0) {
+            continue;
+        }
+        int envelopes = 0;
+        int quiet = 1;
+        for (int j = 0; j < pack->nodeCount && quiet; j++) {
+            const SynthPackNode_t *node = &pack->nodes[j];
+            if (node->type == SYNTH_NODE_ENVELOPE) {
+                quiet = node->state[l] == 0 && pack->outputs[j * SYNTH_PACK_BLOCK * pack->voiceCount + last + l] == 0;
+                envelopes++;
+            }
+        }
+        if (quiet && envelopes) {
+            synthPackSwap(pack, l, --pack->active);
+        }
+    }
+}
+
+void synthPackRender(SynthPack_t *pack, int32_t *mix, int n) {
+    int rowSize = SYNTH_PACK_BLOCK * pack->voiceCount;
+    while (n > 0) {
+        int count = n < SYNTH_PACK_BLOCK ? n : SYNTH_PACK_BLOCK;
+        int lanes = pack->active;
+        pack->synth->nodesTotal += (uint64_t) pack->nodeCount * count * pack->voiceCount;
+        pack->synth->nodesRun += (uint64_t) pack->nodeCount * count * lanes;
+        if (lanes) {
+            for (int k = 0; k < pack->nodeCount; k++) {
+                int j = pack->order[k];
+                synthPackNode(pack, &pack->nodes[j], pack->outputs + j * rowSize, count, lanes);
+            }
+            const q15_t *output = pack->outputs + pack->outputNode * rowSize;
+            for (int t = 0; t < count; t++) {
+                int32_t sum = 0;
+                for (int l = 0; l < lanes; l++) {
+                    sum += output[t * lanes + l];
+                }
+                mix[t] += sum;
+            }
+            synthPackCheckIdle(pack, count, lanes);
+        }
+        mix += count;
+        n -= count;
+    }
+}
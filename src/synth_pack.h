@@ -0,0 +1,92 @@
+//voice packs: many voices playing one patch, with their node state packed by type instead of kept in SynthNode_t.
+//every oscillator phase of every voice sits in one array, then every envelope state, filter accumulator, state
+//variable filter and noise generator, each node's state a row with a lane per voice. each node of the patch runs
+//as one loop over every playing voice, and playing voices are kept in the first lanes so the loops stay dense
+#ifndef __SYNTH_PACK_H
+#define __SYNTH_PACK_H
+
+#include "synth.h"
+
+//max voices in a pack
+#ifndef SYNTH_PACK_VOICES
+#define SYNTH_PACK_VOICES 16
+#endif
+
+//samples each node runs at a time. each node output gets a row of SYNTH_PACK_BLOCK samples for every voice
+#ifndef SYNTH_PACK_BLOCK
+#define SYNTH_PACK_BLOCK 8
+#endif
+
+//a node input: a row of node outputs (lanes values for each sample), or one value every voice shares
+typedef struct SynthPackInput {
+    const q15_t *ptr; //NULL for no input
+    int8_t row; //node index, nodeCount + k for secondary output k, or -1 for a shared value
+    uint8_t step; //1 for a row, 0 for a shared value
+} SynthPackInput_t;
+
+//where an oscillator's phase increment comes from
+typedef enum SynthPackIncrement {
+    SYNTH_PACK_INCREMENT_SHARED = 0, //one value every voice shares
+    SYNTH_PACK_INCREMENT_VOICE, //each voice's note
+    SYNTH_PACK_INCREMENT_ROW, //a node output (15 bit phase only)
+} SynthPackIncrement_t;
+
+//a node of the patch, with its inputs resolved to rows and its state to a row of the pack's state
+typedef struct SynthPackNode {
+    uint8_t type; //SynthNodeType_t
+    uint8_t retrigger;
+    uint8_t incrementFrom; //SynthPackIncrement_t
+    uint8_t mode; //svf response
+    SynthPackInput_t gain;
+    SynthPackInput_t inputs[3]; //oscillator detune and position, filter input, mixer inputs, svf input, cutoff and resonance
+    const SynthPhase_t *increment;
+    union {
+        q15_t (*wavegen)(q15_t input);
+        q15_t (*wavegenBl)(q15_t input, q15_t increment);
+        const SynthWavetable_t *table;
+        SynthEnvelope_t env;
+        int32_t factor; //filter factor
+    };
+    int32_t *state; //phases, envelope states, filter accumulators or noise generators, svf low pass then band pass
+    q15_t *taps[4]; //svf responses other nodes read, NULL for the rest
+} SynthPackNode_t;
+
+typedef struct SynthPack {
+    Synth_t *synth;
+    uint8_t voiceCount;
+    uint8_t active; //voices playing, in lanes 0 to active - 1
+    uint8_t nodeCount;
+    uint8_t outputNode;
+    uint8_t order[SYNTH_NODES];
+    SynthPackNode_t *nodes; //the rest is in the instance's arena
+    uint8_t *lanes; //lane of each voice
+    uint8_t *voices; //voice in each lane
+    uint8_t *gate; //for each lane
+    SynthPhase_t *increment; //for each lane
+    int32_t *state; //a row of lanes for each slot of state, oscillators first, then envelopes, filters, svfs and noise
+    int stateRows;
+    q15_t *outputs; //SYNTH_PACK_BLOCK * voiceCount values for each node, then each secondary output read
+} SynthPack_t;
+
+//arena a pack of voices voices playing a patch of nodes nodes takes, at most
+#define SYNTH_PACK_SIZE(voices, nodes) (SYNTH_ARENA_ROUND((nodes) * sizeof(SynthPackNode_t)) + SYNTH_ARENA_ROUND(3 * (voices)) \
+        + SYNTH_ARENA_ROUND((voices) * sizeof(SynthPhase_t)) + SYNTH_ARENA_ROUND((size_t) 2 * (nodes) * (voices) * sizeof(int32_t)) \
+        + SYNTH_ARENA_ROUND((size_t) ((nodes) + SYNTH_TAPS) * SYNTH_PACK_BLOCK * (voices) * sizeof(q15_t)))
+
+//set up a pack of voiceCount voices playing the patch voice is wired with, taking its state from synth's arena.
+//voice is only read as the patch, so don't play it itself. every voice starts from the state its nodes have now,
+//and reads shared inputs like globals or voice->params where voice does. returns 0, or -1 if the arena is full or the
+//patch can't be packed: nodes feed back into each other or read themselves, a node runs at a control rate or is a
+//delay, a node reads another voice or a part of voice other than phaseIncrement, more than SYNTH_TAPS secondary
+//outputs are read, voice is oversampled, glides or plays legato, or voiceCount is over SYNTH_PACK_VOICES
+int synthPackInit(SynthPack_t *pack, Synth_t *synth, SynthVoice_t *voice, int voiceCount);
+
+//start and release notes on a voice of the pack (0 to voiceCount - 1), like synthVoiceNoteOn/Off
+void synthPackNoteOn(SynthPack_t *pack, int voice, uint8_t note);
+void synthPackNoteOff(SynthPack_t *pack, int voice);
+
+//add n samples of the pack's voices into mix, exactly what the same voices wired normally would give with synthProcess().
+//like compiled patches, mix can be turned into output samples with synthMixdown(synth, ...)
+void synthPackRender(SynthPack_t *pack, int32_t *mix, int n);
+
+#endif // __SYNTH_PACK_H
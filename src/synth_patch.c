@@ -0,0 +1,587 @@
+//patch files, see synth_patch.h
+
+#include "synth_patch.h"
+#include "stdio.h"
+#include "stdarg.h"
+#include "string.h"
+
+#define SYNTH_PATCH_COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+//indexed by SynthPatchWavegen_t
+static q15_t (*const synthPatchWavegens[])(q15_t input) = {
+    sawtoothWave, sineWave, squareWave, triangleWave, fallingWave, expDecayWave,
+};
+static const char *const synthPatchWavegenNames[] = {"sawtooth", "sine", "square", "triangle", "falling", "exp_decay"};
+static q15_t (*const synthPatchWavegensBl[])(q15_t input, q15_t increment) = {
+    sawtoothWaveBl, squareWaveBl, pulseWaveBl,
+};
+static const char *const synthPatchWavegenBlNames[] = {"sawtooth_bl", "square_bl", "pulse_bl"};
+static const char *const synthPatchModeNames[] = {"lp", "hp", "bp", "notch"};
+
+//what follows the gain input for each node type
+typedef struct SynthPatchLayout {
+    const char *name;
+    uint8_t inputCount;
+    const char *inputs[3];
+    const char *choice; //byte after the inputs, NULL for none
+    uint8_t valueCount; //16 bit settings after that
+    const char *values[4];
+} SynthPatchLayout_t;
+
+static const SynthPatchLayout_t synthPatchLayouts[SYNTH_NODE_END] = {
+    [SYNTH_NODE_OSCILLATOR] = {"oscillator", 2, {"increment", "detune"}, "wavegen"},
+    [SYNTH_NODE_ENVELOPE] = {"envelope", 0, {0}, NULL, 4, {"attack", "decay", "sustain", "release"}},
+    [SYNTH_NODE_FILTER_LP] = {"filter_lp", 1, {"input"}, NULL, 1, {"factor"}},
+    [SYNTH_NODE_FILTER_HP] = {"filter_hp", 1, {"input"}, NULL, 1, {"factor"}},
+    [SYNTH_NODE_MIXER] = {"mixer", 3, {"input1", "input2", "input3"}},
+    [SYNTH_NODE_OSCILLATOR_BL] = {"oscillator_bl", 2, {"increment", "detune"}, "wavegen"},
+    [SYNTH_NODE_WAVETABLE] = {"wavetable", 3, {"increment", "detune", "position"}, "table"},
+    [SYNTH_NODE_FILTER_SVF] = {"filter_svf", 3, {"input", "cutoff", "resonance"}, "mode"},
+    [SYNTH_NODE_NOISE] = {"noise", 0, {0}, NULL, 2, {"seed_low", "seed_high"}},
+    [SYNTH_NODE_DELAY] = {"delay", 3, {"input", "time", "feedback"}},
+};
+
+//oscillators take their phase increment as the first input after gain
+static int synthPatchIsOsc(int type) {
+    return type == SYNTH_NODE_OSCILLATOR || type == SYNTH_NODE_OSCILLATOR_BL || type == SYNTH_NODE_WAVETABLE;
+}
+
+//a node read from a patch
+typedef struct SynthPatchNode {
+    uint8_t type;
+    uint8_t rate;
+    uint8_t retrigger;
+    uint8_t inputs[4][2]; //gain, then the type's inputs, as a SynthPatchInput_t and its index
+    uint8_t choice;
+    int16_t values[4];
+} SynthPatchNode_t;
+
+static int32_t synthPatchRead32(const uint8_t *p) {
+    return (int32_t) ((uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24);
+}
+
+static int synthPatchCheckInput(const uint8_t *data, const SynthPatchNode_t *nodes, const uint8_t *input, int increment) {
+    int nodeCount = data[5];
+    int paramCount = data[6];
+    switch (input[0]) {
+        case SYNTH_PATCH_INPUT_NONE:
+            //oscillators always read their phase increment
+            return !increment && input[1] == 0;
+        case SYNTH_PATCH_INPUT_NODE:
+            return input[1] < nodeCount && (!increment || !SYNTH_PHASE_32);
+        case SYNTH_PATCH_INPUT_TAP:
+            return (input[1] >> 2) < nodeCount && nodes[input[1] >> 2].type == SYNTH_NODE_FILTER_SVF
+                    && (!increment || !SYNTH_PHASE_32);
+        case SYNTH_PATCH_INPUT_PARAM:
+            return input[1] < paramCount
+                    && data[SYNTH_PATCH_HEADER_SIZE + input[1] * 5] == (increment ? SYNTH_PATCH_PARAM_INCREMENT : SYNTH_PATCH_PARAM_VALUE);
+        case SYNTH_PATCH_INPUT_PITCH:
+            return increment && input[1] == 0;
+        default:
+            return 0;
+    }
+}
+
+//read and check a patch's nodes
+static int synthPatchDecode(const uint8_t *data, size_t size, int tableCount, SynthPatchNode_t *nodes) {
+    if (size < SYNTH_PATCH_HEADER_SIZE || memcmp(data, "SYPA", 4) || data[4] != SYNTH_PATCH_VERSION
+            || data[5] > SYNTH_NODES || (data[7] >= data[5] && data[7] != 0)) {
+        return -1;
+    }
+    int nodeCount = data[5];
+    int paramCount = data[6];
+    size_t pos = SYNTH_PATCH_HEADER_SIZE + paramCount * 5;
+    if (pos > size) {
+        return -1;
+    }
+    for (int k = 0; k < paramCount; k++) {
+        const uint8_t *param = data + SYNTH_PATCH_HEADER_SIZE + k * 5;
+        int32_t value = synthPatchRead32(param + 1);
+        if (param[0] > SYNTH_PATCH_PARAM_INCREMENT || (param[0] == SYNTH_PATCH_PARAM_VALUE && (value < -32768 || value > 32767))) {
+            return -1;
+        }
+    }
+    for (int i = 0; i < nodeCount; i++) {
+        SynthPatchNode_t *node = &nodes[i];
+        memset(node, 0, sizeof(SynthPatchNode_t));
+        if (size - pos < 4) {
+            return -1;
+        }
+        node->type = data[pos];
+        node->rate = data[pos + 1] & 0x0F;
+        node->retrigger = data[pos + 1] >> 4;
+        if (node->type == SYNTH_NODE_NONE || node->type >= SYNTH_NODE_END) {
+            return -1;
+        }
+        const SynthPatchLayout_t *layout = &synthPatchLayouts[node->type];
+        if (node->retrigger > SYNTH_RETRIGGER_LEVEL) {
+            return -1;
+        }
+        if (node->rate > SYNTH_CONTROL_RATE_MAX || (node->rate && node->type != SYNTH_NODE_ENVELOPE && node->type != SYNTH_NODE_OSCILLATOR)) {
+            return -1;
+        }
+        size_t length = 2 + (1 + layout->inputCount) * 2 + (layout->choice != NULL) + layout->valueCount * 2;
+        if (size - pos < length) {
+            return -1;
+        }
+        const uint8_t *p = data + pos + 2;
+        for (int k = 0; k <= layout->inputCount; k++, p += 2) {
+            node->inputs[k][0] = p[0];
+            node->inputs[k][1] = p[1];
+        }
+        if (layout->choice) {
+            node->choice = *p++;
+        }
+        for (int k = 0; k < layout->valueCount; k++, p += 2) {
+            node->values[k] = (int16_t) (p[0] | p[1] << 8);
+        }
+        pos += length;
+        int choices = node->type == SYNTH_NODE_OSCILLATOR ? (int) SYNTH_PATCH_COUNT(synthPatchWavegens)
+                : node->type == SYNTH_NODE_OSCILLATOR_BL ? (int) SYNTH_PATCH_COUNT(synthPatchWavegensBl)
+                : node->type == SYNTH_NODE_WAVETABLE ? tableCount
+                : node->type == SYNTH_NODE_FILTER_SVF ? 4 : 1;
+        if (node->choice >= choices) {
+            return -1;
+        }
+    }
+    if (pos != size) {
+        return -1;
+    }
+    //inputs can read nodes further on, so they're checked once every node's type is known
+    for (int i = 0; i < nodeCount; i++) {
+        const SynthPatchNode_t *node = &nodes[i];
+        for (int k = 0; k <= synthPatchLayouts[node->type].inputCount; k++) {
+            if (!synthPatchCheckInput(data, nodes, node->inputs[k], k == 1 && synthPatchIsOsc(node->type))) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int synthPatchCheck(const uint8_t *data, size_t size, int tableCount) {
+    SynthPatchNode_t nodes[SYNTH_NODES];
+    return synthPatchDecode(data, size, tableCount, nodes);
+}
+
+static q15_t *synthPatchPointer(SynthVoice_t *voice, const uint8_t *input) {
+    switch (input[0]) {
+        case SYNTH_PATCH_INPUT_NODE:
+            return &voice->nodes[input[1]].output;
+        case SYNTH_PATCH_INPUT_TAP:
+            return &voice->nodes[input[1] >> 2].svf.outputs[input[1] & 3];
+        case SYNTH_PATCH_INPUT_PARAM:
+            return &voice->params[input[1]].value;
+        default:
+            return NULL;
+    }
+}
+
+static SynthPhase_t *synthPatchIncrement(SynthVoice_t *voice, const uint8_t *input) {
+    if (input[0] == SYNTH_PATCH_INPUT_PITCH) {
+        return &voice->phaseIncrement;
+    }
+    if (input[0] == SYNTH_PATCH_INPUT_PARAM) {
+        return &voice->params[input[1]].increment;
+    }
+    //a node output, 15 bit phase only
+    return (SynthPhase_t *) synthPatchPointer(voice, input);
+}
+
+//lines in pool no node has
+static int synthPatchFreeLines(const SynthDelayPool_t *pool) {
+    int lines = 0;
+    for (int k = 0; k < pool->lineCount; k++) {
+        lines += !(pool->used & (1UL << k));
+    }
+    return lines;
+}
+
+int synthPatchApply(SynthVoice_t *voice, const uint8_t *data, size_t size, const SynthWavetable_t *tables, int tableCount) {
+    SynthPatchNode_t nodes[SYNTH_NODES];
+    if (synthPatchDecode(data, size, tableCount, nodes) || data[5] > voice->nodeCapacity || data[6] > voice->paramCount) {
+        return -1;
+    }
+    int nodeCount = data[5];
+    //delay nodes that stay delays keep their lines and the rest go back to the pool, so count what that leaves free
+    //before touching anything, and only give lines back once the new delay nodes are sure to get theirs
+    SynthDelayPool_t *pool = &voice->synth->delayPool;
+    int lines = -synthPatchFreeLines(pool);
+    for (int i = 0; i < voice->nodeCapacity; i++) {
+        SynthNode_t *node = &voice->nodes[i];
+        int delay = i < nodeCount && nodes[i].type == SYNTH_NODE_DELAY;
+        int owned = node->type == SYNTH_NODE_DELAY && node->delay.line && node->delay.pool == pool;
+        lines += delay - owned;
+    }
+    if (lines > 0) {
+        return -1;
+    }
+    for (int i = 0; i < voice->nodeCapacity; i++) {
+        SynthNode_t *node = &voice->nodes[i];
+        if (node->type == SYNTH_NODE_DELAY && !(i < nodeCount && nodes[i].type == SYNTH_NODE_DELAY && node->delay.pool == pool)) {
+            synthNodeClear(node);
+        }
+    }
+    for (int k = 0; k < data[6]; k++) {
+        const uint8_t *param = data + SYNTH_PATCH_HEADER_SIZE + k * 5;
+        uint32_t value = synthPatchRead32(param + 1);
+        if (param[0] == SYNTH_PATCH_PARAM_INCREMENT) {
+#if SYNTH_PHASE_32
+            voice->params[k].increment = value;
+#else
+            voice->params[k].increment = value >> 17;
+#endif
+        } else {
+            voice->params[k].value = (q15_t) value;
+        }
+    }
+    for (int i = nodeCount; i < voice->nodeCapacity; i++) {
+        synthNodeClear(&voice->nodes[i]);
+    }
+    for (int i = 0; i < nodeCount; i++) {
+        const SynthPatchNode_t *p = &nodes[i];
+        SynthNode_t *node = &voice->nodes[i];
+        q15_t *gain = synthPatchPointer(voice, p->inputs[0]);
+        switch (p->type) {
+            case SYNTH_NODE_OSCILLATOR:
+                synthInitOscNode(node, gain, synthPatchIncrement(voice, p->inputs[1]), synthPatchPointer(voice, p->inputs[2]),
+                        synthPatchWavegens[p->choice]);
+                break;
+            case SYNTH_NODE_OSCILLATOR_BL:
+                synthInitOscBlNode(node, gain, synthPatchIncrement(voice, p->inputs[1]), synthPatchPointer(voice, p->inputs[2]),
+                        synthPatchWavegensBl[p->choice]);
+                break;
+            case SYNTH_NODE_WAVETABLE:
+                synthInitWavetableNode(node, gain, synthPatchIncrement(voice, p->inputs[1]), synthPatchPointer(voice, p->inputs[2]),
+                        &tables[p->choice], synthPatchPointer(voice, p->inputs[3]));
+                break;
+            case SYNTH_NODE_ENVELOPE:
+                synthInitEnvelopeNode(node, gain, p->values[0], p->values[1], p->values[2], p->values[3]);
+                break;
+            case SYNTH_NODE_FILTER_LP:
+                synthInitFilterLpNode(node, gain, synthPatchPointer(voice, p->inputs[1]), p->values[0]);
+                break;
+            case SYNTH_NODE_FILTER_HP:
+                synthInitFilterHpNode(node, gain, synthPatchPointer(voice, p->inputs[1]), p->values[0]);
+                break;
+            case SYNTH_NODE_MIXER:
+                synthInitMixerNode(node, gain, synthPatchPointer(voice, p->inputs[1]), synthPatchPointer(voice, p->inputs[2]),
+                        synthPatchPointer(voice, p->inputs[3]));
+                break;
+            case SYNTH_NODE_FILTER_SVF:
+                synthInitFilterSvfNode(node, gain, synthPatchPointer(voice, p->inputs[1]), synthPatchPointer(voice, p->inputs[2]),
+                        synthPatchPointer(voice, p->inputs[3]), p->choice);
+                break;
+            case SYNTH_NODE_NOISE:
+                synthInitNoiseNode(node, gain, (uint16_t) p->values[0] | (uint32_t) (uint16_t) p->values[1] << 16);
+                break;
+            case SYNTH_NODE_DELAY:
+                synthInitDelayNode(node, gain, synthPatchPointer(voice, p->inputs[1]), synthPatchPointer(voice, p->inputs[2]),
+                        synthPatchPointer(voice, p->inputs[3]), pool);
+                break;
+        }
+        synthNodeSetRate(node, p->rate);
+        synthNodeSetRetrigger(node, p->retrigger);
+    }
+    voice->outputNode = data[7];
+    //clearing nodes doesn't count as rewiring, so don't wait for the renderer to notice
+    synthVoiceSchedule(voice);
+    return 0;
+}
+
+SynthVoice_t *synthPatchLoad(Synth_t *synth, int index, const uint8_t *data, size_t size, const SynthWavetable_t *tables, int tableCount) {
+    SynthPatchNode_t nodes[SYNTH_NODES];
+    if (synthPatchDecode(data, size, tableCount, nodes)) {
+        return NULL;
+    }
+    //check everything that could fail before taking the voice, so a patch that can't load leaves it free
+    int lines = 0;
+    for (int i = 0; i < data[5]; i++) {
+        lines += nodes[i].type == SYNTH_NODE_DELAY;
+    }
+    size_t arenaSize = SYNTH_ARENA_ROUND(data[5] * sizeof(SynthNode_t)) + SYNTH_ARENA_ROUND(data[6] * sizeof(SynthParam_t));
+    if (lines > synthPatchFreeLines(&synth->delayPool) || arenaSize > synth->arenaSize - synth->arenaUsed) {
+        return NULL;
+    }
+    SynthVoice_t *voice = synthVoiceAlloc(synth, index, data[5]);
+    if (!voice) {
+        return NULL;
+    }
+    if (data[6]) {
+        voice->params = synthArenaAlloc(synth, data[6] * sizeof(SynthParam_t));
+        voice->paramCount = data[6];
+    }
+    return synthPatchApply(voice, data, size, tables, tableCount) ? NULL : voice;
+}
+
+//state for writing a voice out
+typedef struct SynthPatchWriter {
+    SynthVoice_t *voice;
+    uint8_t *data;
+    size_t size;
+    size_t pos;
+    int bad;
+    uint8_t paramCount;
+    const void *params[SYNTH_NODES * 4]; //what each parameter was made from
+    uint8_t paramKinds[SYNTH_NODES * 4];
+    int32_t paramValues[SYNTH_NODES * 4];
+} SynthPatchWriter_t;
+
+static void synthPatchPut(SynthPatchWriter_t *writer, int value) {
+    if (writer->pos < writer->size) {
+        writer->data[writer->pos] = value;
+    } else {
+        writer->bad = 1;
+    }
+    writer->pos++;
+}
+
+static void synthPatchPut16(SynthPatchWriter_t *writer, int value) {
+    synthPatchPut(writer, value & 0xFF);
+    synthPatchPut(writer, (value >> 8) & 0xFF);
+}
+
+//write an input, a phase increment if increment is set
+static void synthPatchPutInput(SynthPatchWriter_t *writer, const void *p, int increment) {
+    SynthVoice_t *voice = writer->voice;
+    uintptr_t addr = (uintptr_t) p;
+    uintptr_t nodesStart = (uintptr_t) voice->nodes;
+    if (!p) {
+        synthPatchPut16(writer, SYNTH_PATCH_INPUT_NONE);
+        return;
+    }
+    if (increment && p == &voice->phaseIncrement) {
+        synthPatchPut16(writer, SYNTH_PATCH_INPUT_PITCH);
+        return;
+    }
+    if (addr >= nodesStart && addr < nodesStart + voice->nodeCount * sizeof(SynthNode_t)) {
+        int j = (addr - nodesStart) / sizeof(SynthNode_t);
+        SynthNode_t *node = &voice->nodes[j];
+        writer->bad |= increment && SYNTH_PHASE_32;
+        if (p == &node->output) {
+            synthPatchPut(writer, SYNTH_PATCH_INPUT_NODE);
+            synthPatchPut(writer, j);
+        } else if (node->type == SYNTH_NODE_FILTER_SVF && p >= (void *) node->svf.outputs && p < (void *) (node->svf.outputs + 4)) {
+            synthPatchPut(writer, SYNTH_PATCH_INPUT_TAP);
+            synthPatchPut(writer, j << 2 | ((const q15_t *) p - node->svf.outputs));
+        } else {
+            writer->bad = 1;
+            synthPatchPut16(writer, SYNTH_PATCH_INPUT_NONE);
+        }
+        return;
+    }
+    //anything else becomes a parameter, one for each thing read
+    int kind = increment ? SYNTH_PATCH_PARAM_INCREMENT : SYNTH_PATCH_PARAM_VALUE;
+    int k = 0;
+    while (k < writer->paramCount && (writer->params[k] != p || writer->paramKinds[k] != kind)) {
+        k++;
+    }
+    if (k == writer->paramCount) {
+        writer->params[k] = p;
+        writer->paramKinds[k] = kind;
+#if SYNTH_PHASE_32
+        writer->paramValues[k] = increment ? (int32_t) *(const SynthPhase_t *) p : *(const q15_t *) p;
+#else
+        writer->paramValues[k] = increment ? (int32_t) ((uint32_t) (uint16_t) *(const SynthPhase_t *) p << 17) : *(const q15_t *) p;
+#endif
+        writer->paramCount++;
+    }
+    synthPatchPut(writer, SYNTH_PATCH_INPUT_PARAM);
+    synthPatchPut(writer, k);
+}
+
+static int synthPatchFindWavegen(SynthNode_t *node) {
+    for (int k = 0; k < (int) SYNTH_PATCH_COUNT(synthPatchWavegens) && node->type == SYNTH_NODE_OSCILLATOR; k++) {
+        if (node->osc.wavegen == synthPatchWavegens[k]) {
+            return k;
+        }
+    }
+    for (int k = 0; k < (int) SYNTH_PATCH_COUNT(synthPatchWavegensBl) && node->type == SYNTH_NODE_OSCILLATOR_BL; k++) {
+        if (node->osc.wavegenBl == synthPatchWavegensBl[k]) {
+            return k;
+        }
+    }
+    return -1;
+}
+
+int synthPatchSave(SynthVoice_t *voice, uint8_t *data, size_t size, const SynthWavetable_t *tables, int tableCount) {
+    synthVoiceSchedule(voice);
+    //nodes go after the parameters, which are only known once every input has been seen, so they're written to a
+    //buffer first and copied in after
+    uint8_t nodeBytes[SYNTH_NODES * 12];
+    SynthPatchWriter_t writer = {.voice = voice, .data = nodeBytes, .size = sizeof(nodeBytes)};
+    writer.bad = voice->linked;
+    for (int i = 0; i < voice->nodeCount; i++) {
+        SynthNode_t *node = &voice->nodes[i];
+        synthPatchPut(&writer, node->type);
+        synthPatchPut(&writer, node->rate | node->retrigger << 4);
+        synthPatchPutInput(&writer, node->gain, 0);
+        switch (node->type) {
+            case SYNTH_NODE_OSCILLATOR:
+            case SYNTH_NODE_OSCILLATOR_BL:
+            case SYNTH_NODE_WAVETABLE: {
+                synthPatchPutInput(&writer, node->osc.phaseIncrement, 1);
+                synthPatchPutInput(&writer, node->osc.detune, 0);
+                int choice = synthPatchFindWavegen(node);
+                if (node->type == SYNTH_NODE_WAVETABLE) {
+                    synthPatchPutInput(&writer, node->osc.position, 0);
+                    choice = -1;
+                    for (int k = 0; k < tableCount && choice < 0; k++) {
+                        if (node->osc.table == &tables[k]) {
+                            choice = k;
+                        }
+                    }
+                }
+                writer.bad |= choice < 0 || choice > 0xFF;
+                synthPatchPut(&writer, choice);
+                break;
+            }
+            case SYNTH_NODE_ENVELOPE:
+                synthPatchPut16(&writer, node->env.attack);
+                synthPatchPut16(&writer, node->env.decay);
+                synthPatchPut16(&writer, node->env.sustain);
+                synthPatchPut16(&writer, node->env.release);
+                break;
+            case SYNTH_NODE_FILTER_LP:
+            case SYNTH_NODE_FILTER_HP:
+                synthPatchPutInput(&writer, node->filter.input, 0);
+                writer.bad |= node->filter.factor < -32768 || node->filter.factor > 32767;
+                synthPatchPut16(&writer, node->filter.factor);
+                break;
+            case SYNTH_NODE_MIXER:
+                for (int k = 0; k < 3; k++) {
+                    synthPatchPutInput(&writer, node->mixer.inputs[k], 0);
+                }
+                break;
+            case SYNTH_NODE_FILTER_SVF:
+                synthPatchPutInput(&writer, node->svf.input, 0);
+                synthPatchPutInput(&writer, node->svf.cutoff, 0);
+                synthPatchPutInput(&writer, node->svf.resonance, 0);
+                synthPatchPut(&writer, node->svf.mode);
+                break;
+            case SYNTH_NODE_NOISE:
+                //where the generator is now, so a loaded voice carries on with the same noise
+                synthPatchPut16(&writer, node->state & 0xFFFF);
+                synthPatchPut16(&writer, (uint32_t) node->state >> 16);
+                break;
+            case SYNTH_NODE_DELAY:
+                synthPatchPutInput(&writer, node->delay.input, 0);
+                synthPatchPutInput(&writer, node->delay.time, 0);
+                synthPatchPutInput(&writer, node->delay.feedback, 0);
+                break;
+            default:
+                break;
+        }
+    }
+    if (writer.bad) {
+        return -1;
+    }
+    size_t nodesSize = writer.pos;
+    writer.data = data;
+    writer.size = size;
+    writer.pos = 0;
+    uint8_t header[SYNTH_PATCH_HEADER_SIZE] = {'S', 'Y', 'P', 'A', SYNTH_PATCH_VERSION, voice->nodeCount, writer.paramCount,
+            voice->nodeCount ? voice->outputNode : 0};
+    for (int k = 0; k < SYNTH_PATCH_HEADER_SIZE; k++) {
+        synthPatchPut(&writer, header[k]);
+    }
+    for (int k = 0; k < writer.paramCount; k++) {
+        uint32_t value = writer.paramValues[k];
+        synthPatchPut(&writer, writer.paramKinds[k]);
+        synthPatchPut16(&writer, value & 0xFFFF);
+        synthPatchPut16(&writer, value >> 16);
+    }
+    for (size_t k = 0; k < nodesSize; k++) {
+        synthPatchPut(&writer, nodeBytes[k]);
+    }
+    //e.g. an output node past the end of the chain
+    if (writer.bad || synthPatchCheck(data, writer.pos, tableCount)) {
+        return -1;
+    }
+    return writer.pos;
+}
+
+//append to text like snprintf, keeping count of the full length
+typedef struct SynthPatchText {
+    char *text;
+    size_t size;
+    size_t length;
+} SynthPatchText_t;
+
+static void synthPatchAppend(SynthPatchText_t *out, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    size_t room = out->length < out->size ? out->size - out->length : 0;
+    int res = vsnprintf(room ? out->text + out->length : NULL, room, format, args);
+    va_end(args);
+    if (res > 0) {
+        out->length += res;
+    }
+}
+
+static void synthPatchAppendInput(SynthPatchText_t *out, const char *name, const uint8_t *input) {
+    switch (input[0]) {
+        case SYNTH_PATCH_INPUT_NONE:
+            synthPatchAppend(out, " %s none", name);
+            break;
+        case SYNTH_PATCH_INPUT_NODE:
+            synthPatchAppend(out, " %s node %d", name, input[1]);
+            break;
+        case SYNTH_PATCH_INPUT_TAP:
+            synthPatchAppend(out, " %s node %d %s", name, input[1] >> 2, synthPatchModeNames[input[1] & 3]);
+            break;
+        case SYNTH_PATCH_INPUT_PARAM:
+            synthPatchAppend(out, " %s param %d", name, input[1]);
+            break;
+        case SYNTH_PATCH_INPUT_PITCH:
+            synthPatchAppend(out, " %s pitch", name);
+            break;
+    }
+}
+
+int synthPatchPrint(const uint8_t *data, size_t size, char *text, size_t textSize) {
+    SynthPatchNode_t nodes[SYNTH_NODES];
+    //any table index is fine to print
+    if (synthPatchDecode(data, size, 256, nodes)) {
+        return -1;
+    }
+    SynthPatchText_t out = {text, textSize, 0};
+    if (textSize) {
+        text[0] = 0;
+    }
+    synthPatchAppend(&out, "patch version %d nodes %d params %d output %d\n", data[4], data[5], data[6], data[7]);
+    for (int k = 0; k < data[6]; k++) {
+        const uint8_t *param = data + SYNTH_PATCH_HEADER_SIZE + k * 5;
+        synthPatchAppend(&out, "param %d %s %ld\n", k, param[0] == SYNTH_PATCH_PARAM_INCREMENT ? "increment" : "value",
+                (long) synthPatchRead32(param + 1));
+    }
+    for (int i = 0; i < data[5]; i++) {
+        const SynthPatchNode_t *node = &nodes[i];
+        const SynthPatchLayout_t *layout = &synthPatchLayouts[node->type];
+        synthPatchAppend(&out, "node %d %s", i, layout->name);
+        if (node->rate) {
+            synthPatchAppend(&out, " rate %d", node->rate);
+        }
+        if (node->retrigger) {
+            synthPatchAppend(&out, " retrigger %s", node->retrigger == SYNTH_RETRIGGER_FREE ? "free" : "level");
+        }
+        synthPatchAppendInput(&out, "gain", node->inputs[0]);
+        for (int k = 0; k < layout->inputCount; k++) {
+            synthPatchAppendInput(&out, layout->inputs[k], node->inputs[k + 1]);
+        }
+        if (node->type == SYNTH_NODE_OSCILLATOR) {
+            synthPatchAppend(&out, " wavegen %s", synthPatchWavegenNames[node->choice]);
+        } else if (node->type == SYNTH_NODE_OSCILLATOR_BL) {
+            synthPatchAppend(&out, " wavegen %s", synthPatchWavegenBlNames[node->choice]);
+        } else if (node->type == SYNTH_NODE_WAVETABLE) {
+            synthPatchAppend(&out, " table %d", node->choice);
+        } else if (node->type == SYNTH_NODE_FILTER_SVF) {
+            synthPatchAppend(&out, " mode %s", synthPatchModeNames[node->choice]);
+        }
+        for (int k = 0; k < layout->valueCount; k++) {
+            synthPatchAppend(&out, " %s %d", layout->values[k], node->values[k]);
+        }
+        synthPatchAppend(&out, "\n");
+    }
+    return out.length;
+}
@@ -0,0 +1,84 @@
+//patch files: a voice's nodes and settings as bytes, with inputs referring to nodes by index instead of by pointer.
+//patches can sit in flash or come from a file, and are checked before anything is wired up, so a program change is
+//loading one into a voice instead of a sequence of synthInit*Node calls
+#ifndef __SYNTH_PATCH_H
+#define __SYNTH_PATCH_H
+
+#include "synth.h"
+
+//patch layout, all little endian:
+//  "SYPA", then a version byte, node count, parameter count and output node
+//  parameters: a kind byte (SynthPatchParam_t) and a 32 bit value each
+//  nodes: a type byte, a byte with the control rate in the low 4 bits and SynthRetrigger_t in the top 4, and the gain
+//  input, then the inputs and settings for the type:
+//    oscillator, band limited oscillator: phase increment and detune inputs, wavegen byte (SynthPatchWavegen_t)
+//    wavetable: phase increment, detune and position inputs, table byte (index into the tables passed in)
+//    envelope: attack, decay, sustain, release as 16 bit values
+//    low pass, high pass filter: input, 16 bit factor
+//    mixer: 3 inputs
+//    state variable filter: input, cutoff and resonance inputs, mode byte
+//    noise: 32 bit seed as two 16 bit values, low half first
+//    delay: input, time and feedback inputs. the line comes from the instance's delay pool
+//  inputs are 2 bytes, a SynthPatchInput_t then the node, node << 2 | output for a tap, or parameter index
+#define SYNTH_PATCH_HEADER_SIZE 8
+#define SYNTH_PATCH_VERSION 1
+//big enough for any patch synthPatchSave writes
+#define SYNTH_PATCH_MAX_SIZE (SYNTH_PATCH_HEADER_SIZE + SYNTH_NODES * (12 + 4 * 5))
+
+typedef enum SynthPatchInput {
+    SYNTH_PATCH_INPUT_NONE = 0, //NULL
+    SYNTH_PATCH_INPUT_NODE, //a node's output
+    SYNTH_PATCH_INPUT_TAP, //a node's secondary output, e.g. a state variable filter's band pass
+    SYNTH_PATCH_INPUT_PARAM, //a parameter
+    SYNTH_PATCH_INPUT_PITCH, //the voice's phaseIncrement, for phase increments only
+} SynthPatchInput_t;
+
+typedef enum SynthPatchParam {
+    SYNTH_PATCH_PARAM_VALUE = 0, //a q15 value
+    SYNTH_PATCH_PARAM_INCREMENT, //a phase increment, stored with a full cycle being 2^32 whatever SYNTH_PHASE_32 is
+} SynthPatchParam_t;
+
+typedef enum SynthPatchWavegen {
+    SYNTH_PATCH_SAWTOOTH = 0,
+    SYNTH_PATCH_SINE,
+    SYNTH_PATCH_SQUARE,
+    SYNTH_PATCH_TRIANGLE,
+    SYNTH_PATCH_FALLING,
+    SYNTH_PATCH_EXP_DECAY,
+    //band limited, for SYNTH_NODE_OSCILLATOR_BL
+    SYNTH_PATCH_SAWTOOTH_BL = 0,
+    SYNTH_PATCH_SQUARE_BL,
+    SYNTH_PATCH_PULSE_BL,
+} SynthPatchWavegen_t;
+
+//check that size bytes of data are a patch that can be loaded, with tableCount wavetables to pick from.
+//returns 0, or -1 if it isn't valid: a bad header or length, an unknown node type or wavegen, an input reading a
+//node, tap or parameter that isn't there or isn't the right kind, or a node output as a phase increment with
+//SYNTH_PHASE_32
+int synthPatchCheck(const uint8_t *data, size_t size, int tableCount);
+
+//give voice index of the instance the patch's nodes and parameters from the arena (exactly as many as it needs),
+//and wire them up. tables are the wavetables the patch's wavetable nodes pick from by index, and must outlive the
+//voice. returns the voice, or NULL if the patch isn't valid, the voice already has nodes, the arena is full or the
+//delay pool doesn't have a line for each delay node. all of those are checked before the voice is taken, so it's
+//left free if loading fails
+SynthVoice_t *synthPatchLoad(Synth_t *synth, int index, const uint8_t *data, size_t size, const SynthWavetable_t *tables, int tableCount);
+
+//rewire a voice that already has nodes and parameters with a patch, e.g. for a program change. the voice needs at
+//least as many nodes and parameters as the patch, and the rest of its nodes are cleared. nodes start from scratch,
+//so it's best done between notes. delay nodes that stay delay nodes keep their lines, others get lines from the
+//instance's delay pool, and lines of nodes that aren't delays any more go back. returns 0, or -1 if the patch isn't
+//valid or doesn't fit, including not enough free delay lines, in which case the voice is left as it was
+int synthPatchApply(SynthVoice_t *voice, const uint8_t *data, size_t size, const SynthWavetable_t *tables, int tableCount);
+
+//write a voice's nodes (up to the first SYNTH_NODE_NONE) out as a patch. inputs that aren't the voice's nodes or
+//phaseIncrement, like the voice's parameters or globals, become parameters with the value they have now.
+//returns the patch size, or -1 if data is too small or the voice can't be written: it reads another voice or a part
+//of a node that isn't an output, or uses a wavegen or wavetable that isn't one of the built in ones or in tables
+int synthPatchSave(SynthVoice_t *voice, uint8_t *data, size_t size, const SynthWavetable_t *tables, int tableCount);
+
+//write a patch out as text, a line for each parameter and node, for reading or diffing patches.
+//returns the text length like snprintf (it's cut short if that's textSize or more), or -1 if the patch isn't valid
+int synthPatchPrint(const uint8_t *data, size_t size, char *text, size_t textSize);
+
+#endif // __SYNTH_PATCH_H
@@ -0,0 +1,126 @@
+//polyphonic voice allocation: maps midi notes onto a pool of voices that share a patch
+
+#include "synth_poly.h"
+#include "string.h"
+
+static void synthPolyUnlink(SynthPoly_t *poly, SynthPolyList_t *list, uint8_t v) {
+    uint8_t prev = poly->prev[v];
+    uint8_t next = poly->next[v];
+    if (prev == SYNTH_POLY_NONE) {
+        list->head = next;
+    } else {
+        poly->next[prev] = next;
+    }
+    if (next == SYNTH_POLY_NONE) {
+        list->tail = prev;
+    } else {
+        poly->prev[next] = prev;
+    }
+}
+
+static void synthPolyAppend(SynthPoly_t *poly, SynthPolyList_t *list, uint8_t v) {
+    poly->next[v] = SYNTH_POLY_NONE;
+    poly->prev[v] = list->tail;
+    if (list->tail == SYNTH_POLY_NONE) {
+        list->head = v;
+    } else {
+        poly->next[list->tail] = v;
+    }
+    list->tail = v;
+}
+
+//loudest envelope in the voice, idle voices are 0
+static int32_t synthPolyLevel(SynthVoice_t *voice) {
+    int32_t level = 0;
+    if (voice->idle) {
+        return 0;
+    }
+    for (int i = 0; i < voice->nodeCapacity && voice->nodes[i].type != SYNTH_NODE_NONE; i++) {
+        SynthNode_t *node = &voice->nodes[i];
+        if (node->type == SYNTH_NODE_ENVELOPE) {
+            int32_t value = node->state & 0x7FFFFFFF; //drop the decay mode bit
+            if (value > level) {
+                level = value;
+            }
+        }
+    }
+    return level;
+}
+
+//pick a voice off a list, SYNTH_POLY_NONE if it is empty
+static uint8_t synthPolyPick(SynthPoly_t *poly, SynthPolyList_t *list) {
+    uint8_t best = list->head;
+    if (poly->policy == SYNTH_STEAL_QUIETEST && best != SYNTH_POLY_NONE) {
+        int32_t bestLevel = synthPolyLevel(&poly->voices[best]);
+        for (uint8_t v = poly->next[best]; v != SYNTH_POLY_NONE && bestLevel > 0; v = poly->next[v]) {
+            int32_t level = synthPolyLevel(&poly->voices[v]);
+            if (level < bestLevel) {
+                best = v;
+                bestLevel = level;
+            }
+        }
+    }
+    return best;
+}
+
+void synthPolyInit(SynthPoly_t *poly, SynthVoice_t *voices, uint8_t count, SynthStealPolicy_t policy) {
+    if (count > SYNTH_POLY_VOICES) {
+        count = SYNTH_POLY_VOICES;
+    }
+    poly->voices = voices;
+    poly->voiceCount = count;
+    poly->policy = policy;
+    poly->released.head = poly->released.tail = SYNTH_POLY_NONE;
+    poly->held.head = poly->held.tail = SYNTH_POLY_NONE;
+    memset(poly->noteVoice, SYNTH_POLY_NONE, sizeof(poly->noteVoice));
+    for (uint8_t v = 0; v < count; v++) {
+        synthPolyAppend(poly, &poly->released, v);
+    }
+}
+
+SynthVoice_t *synthPolyNoteOn(SynthPoly_t *poly, uint8_t note) {
+    note &= 0x7F;
+    uint8_t v = poly->noteVoice[note];
+    if (v != SYNTH_POLY_NONE) {
+        //already held, retrigger the same voice
+        synthPolyUnlink(poly, &poly->held, v);
+    } else {
+        v = synthPolyPick(poly, &poly->released);
+        if (v != SYNTH_POLY_NONE) {
+            synthPolyUnlink(poly, &poly->released, v);
+        } else {
+            //everything is held, steal one
+            v = synthPolyPick(poly, &poly->held);
+            if (v == SYNTH_POLY_NONE) {
+                return NULL; //empty pool
+            }
+            synthPolyUnlink(poly, &poly->held, v);
+            poly->noteVoice[poly->voices[v].note & 0x7F] = SYNTH_POLY_NONE;
+        }
+        poly->noteVoice[note] = v;
+    }
+    synthPolyAppend(poly, &poly->held, v);
+    SynthVoice_t *voice = &poly->voices[v];
+    synthVoiceNoteOn(voice, note);
+    return voice;
+}
+
+SynthVoice_t *synthPolyNoteOff(SynthPoly_t *poly, uint8_t note) {
+    note &= 0x7F;
+    uint8_t v = poly->noteVoice[note];
+    if (v == SYNTH_POLY_NONE) {
+        return NULL;
+    }
+    poly->noteVoice[note] = SYNTH_POLY_NONE;
+    synthPolyUnlink(poly, &poly->held, v);
+    synthPolyAppend(poly, &poly->released, v);
+    SynthVoice_t *voice = &poly->voices[v];
+    synthVoiceNoteOff(voice);
+    return voice;
+}
+
+void synthPolyAllNotesOff(SynthPoly_t *poly) {
+    while (poly->held.head != SYNTH_POLY_NONE) {
+        synthPolyNoteOff(poly, poly->voices[poly->held.head].note);
+    }
+}
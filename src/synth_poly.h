@@ -0,0 +1,46 @@
+//polyphonic voice allocation: maps midi notes onto a pool of voices that share a patch
+#ifndef __SYNTH_POLY_H
+#define __SYNTH_POLY_H
+
+#include "synth.h"
+
+//max voices in a pool
+#ifndef SYNTH_POLY_VOICES
+#define SYNTH_POLY_VOICES 16
+#endif
+
+#define SYNTH_POLY_NONE 0xFF
+
+//which voice to take for a new note when none are free
+typedef enum SynthStealPolicy {
+    SYNTH_STEAL_OLDEST = 0, //the voice that has been held or released the longest
+    SYNTH_STEAL_QUIETEST, //the voice with the lowest envelope level
+} SynthStealPolicy_t;
+
+//voices are kept on two lists, oldest first: released (gate off, includes idle voices) and held (gate on).
+//new notes take from the released list first, so a voice that is still held is only stolen when all are in use
+typedef struct SynthPolyList {
+    uint8_t head;
+    uint8_t tail;
+} SynthPolyList_t;
+
+typedef struct SynthPoly {
+    SynthVoice_t *voices;
+    uint8_t voiceCount;
+    uint8_t policy;
+    SynthPolyList_t released;
+    SynthPolyList_t held;
+    uint8_t next[SYNTH_POLY_VOICES];
+    uint8_t prev[SYNTH_POLY_VOICES];
+    uint8_t noteVoice[128]; //voice index holding each note, or SYNTH_POLY_NONE
+} SynthPoly_t;
+
+//set up a pool using count voices starting at voices, which should already be wired up
+void synthPolyInit(SynthPoly_t *poly, SynthVoice_t *voices, uint8_t count, SynthStealPolicy_t policy);
+//start a note, returns the voice that plays it
+SynthVoice_t *synthPolyNoteOn(SynthPoly_t *poly, uint8_t note);
+//release a note, returns the voice that was playing it or NULL if it isn't held
+SynthVoice_t *synthPolyNoteOff(SynthPoly_t *poly, uint8_t note);
+void synthPolyAllNotesOff(SynthPoly_t *poly);
+
+#endif // __SYNTH_POLY_H
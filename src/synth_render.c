@@ -0,0 +1,187 @@
+//host only: render voices in parallel on a pool of threads
+
+#include "synth_render.h"
+#include "string.h"
+#include "stdlib.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+typedef struct SynthRenderWorker {
+    SynthRenderPool_t *pool;
+    pthread_t thread;
+    int32_t *mix; //this worker's voices summed over the whole render
+    SynthBlockScratch_t scratch;
+} SynthRenderWorker_t;
+
+struct SynthRenderPool {
+    int threads;
+    SynthRenderWorker_t *workers;
+    size_t mixSize;
+
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned generation; //bumped for each render
+    int pending; //workers still rendering
+    int quit;
+
+    Synth_t *synth; //being rendered
+    size_t n;
+    atomic_int nextVoice;
+};
+
+//render voices until there are none left. which worker gets which voice doesn't matter, the sum is the same
+static void synthRenderVoices(SynthRenderWorker_t *worker) {
+    SynthRenderPool_t *pool = worker->pool;
+    memset(worker->mix, 0, pool->n * sizeof(int32_t));
+    for (;;) {
+        int vi = atomic_fetch_add(&pool->nextVoice, 1);
+        if (vi >= pool->synth->voiceCount) {
+            break;
+        }
+        for (size_t offset = 0; offset < pool->n; offset += SYNTH_BLOCK_SIZE) {
+            size_t count = pool->n - offset;
+            if (count > SYNTH_BLOCK_SIZE) {
+                count = SYNTH_BLOCK_SIZE;
+            }
+            //synthBlockBegin counted all n samples of the voice up front, each block it sits idle for goes back into
+            //voice->nodesSkipped, which synthHeadroom or the next synthBlockBegin takes back once the workers are done
+            synthProcessVoiceBlock(&pool->synth->voices[vi], &worker->scratch, worker->mix + offset, count);
+        }
+    }
+}
+
+static void *synthRenderThread(void *arg) {
+    SynthRenderWorker_t *worker = arg;
+    SynthRenderPool_t *pool = worker->pool;
+    unsigned generation = 0;
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->quit && pool->generation == generation) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->quit) {
+            break;
+        }
+        generation = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        synthRenderVoices(worker);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+SynthRenderPool_t *synthRenderPoolCreate(int threads) {
+    if (threads <= 0) {
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+        if (threads <= 0) {
+            threads = 1;
+        }
+    }
+    SynthRenderPool_t *pool = calloc(1, sizeof(SynthRenderPool_t));
+    if (!pool) {
+        return NULL;
+    }
+    pool->workers = calloc(threads, sizeof(SynthRenderWorker_t));
+    if (!pool->workers) {
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    //worker 0 is the calling thread
+    pool->threads = 1;
+    pool->workers[0].pool = pool;
+    for (int i = 1; i < threads; i++) {
+        SynthRenderWorker_t *worker = &pool->workers[i];
+        worker->pool = pool;
+        if (pthread_create(&worker->thread, NULL, synthRenderThread, worker)) {
+            break;
+        }
+        pool->threads++;
+    }
+    return pool;
+}
+
+void synthRenderPoolDestroy(SynthRenderPool_t *pool) {
+    if (!pool) {
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 1; i < pool->threads; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    for (int i = 0; i < pool->threads; i++) {
+        free(pool->workers[i].mix);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    free(pool->workers);
+    free(pool);
+}
+
+//make sure every worker has room to mix n samples
+static int synthRenderReserve(SynthRenderPool_t *pool, size_t n) {
+    if (n <= pool->mixSize) {
+        return 1;
+    }
+    for (int i = 0; i < pool->threads; i++) {
+        int32_t *mix = realloc(pool->workers[i].mix, n * sizeof(int32_t));
+        if (!mix) {
+            return 0;
+        }
+        pool->workers[i].mix = mix;
+    }
+    pool->mixSize = n;
+    return 1;
+}
+
+void synthRenderPoolProcess(SynthRenderPool_t *pool, Synth_t *synth, q15_t *out, size_t n) {
+    if (n == 0) {
+        return;
+    }
+    if (pool->threads == 1 || synth->voiceCount < 2 || !synthRenderReserve(pool, n) || !synthBlockBegin(synth, n)) {
+        //nothing to gain, out of memory, or voices wired to each other
+        synthProcessBlock(synth, out, n);
+        return;
+    }
+
+    pool->synth = synth;
+    pool->n = n;
+    atomic_store(&pool->nextVoice, 0);
+    pthread_mutex_lock(&pool->lock);
+    pool->pending = pool->threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    synthRenderVoices(&pool->workers[0]);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    //final mix, sum everyone's voices into worker 0's buffer
+    int32_t *mix = pool->workers[0].mix;
+    for (int i = 1; i < pool->threads; i++) {
+        const int32_t *other = pool->workers[i].mix;
+        for (size_t t = 0; t < n; t++) {
+            mix[t] += other[t];
+        }
+    }
+    synthMixdown(synth, mix, out, n);
+}
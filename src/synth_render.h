@@ -0,0 +1,18 @@
+//host only: render voices in parallel on a pool of threads
+#ifndef __SYNTH_RENDER_H
+#define __SYNTH_RENDER_H
+
+#include "synth.h"
+
+typedef struct SynthRenderPool SynthRenderPool_t;
+
+//start a pool with the given number of threads (including the calling thread), or one per core if threads <= 0
+SynthRenderPool_t *synthRenderPoolCreate(int threads);
+void synthRenderPoolDestroy(SynthRenderPool_t *pool);
+
+//same output as synthProcessBlock(synth, out, n). voices are shared out between the threads, each rendering the
+//whole n samples into its own buffer, then the buffers are summed and mixed down.
+//there is some overhead to wake the threads, so render a large n (e.g. a second or more) per call
+void synthRenderPoolProcess(SynthRenderPool_t *pool, Synth_t *synth, q15_t *out, size_t n);
+
+#endif // __SYNTH_RENDER_H
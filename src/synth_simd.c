@@ -0,0 +1,405 @@
+//block kernels for the hot loops, with SIMD versions where the target supports them
+
+#include "synth_simd.h"
+#include "synth_inline.h"
+
+#if SYNTH_SIMD && (defined(__SSE2__) || defined(_M_X64))
+#define SYNTH_SIMD_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) && !defined(__AVX2__)
+//not built for AVX2, but it can still be used if the cpu has it
+#define SYNTH_SIMD_AVX2 1
+#define SYNTH_AVX2_TARGET __attribute__((target("avx2")))
+#elif defined(__AVX2__)
+#define SYNTH_SIMD_AVX2 1
+#define SYNTH_AVX2_TARGET
+#endif
+#if SYNTH_SIMD_AVX2
+#include <immintrin.h>
+#endif
+
+#elif SYNTH_SIMD && defined(__ARM_NEON)
+#define SYNTH_SIMD_NEON 1
+#include <arm_neon.h>
+
+#elif SYNTH_SIMD && defined(__ARM_FEATURE_SIMD32) && defined(__ARM_FEATURE_DSP)
+//Cortex-M4/M7 and friends, two q15 samples per 32 bit register
+#define SYNTH_SIMD_DSP 1
+#include <arm_acle.h>
+#include "string.h"
+#endif
+
+typedef enum SynthWaveKind {
+    SYNTH_WAVE_OTHER = 0,
+    SYNTH_WAVE_SAWTOOTH,
+    SYNTH_WAVE_FALLING,
+    SYNTH_WAVE_TRIANGLE,
+    SYNTH_WAVE_SQUARE,
+    SYNTH_WAVE_EXP_DECAY,
+    SYNTH_WAVE_SINE,
+} SynthWaveKind_t;
+
+static SynthWaveKind_t synthWaveKind(q15_t (*wavegen)(q15_t input)) {
+    if (wavegen == sawtoothWave) return SYNTH_WAVE_SAWTOOTH;
+    if (wavegen == fallingWave) return SYNTH_WAVE_FALLING;
+    if (wavegen == triangleWave) return SYNTH_WAVE_TRIANGLE;
+    if (wavegen == squareWave) return SYNTH_WAVE_SQUARE;
+    if (wavegen == expDecayWave) return SYNTH_WAVE_EXP_DECAY;
+    if (wavegen == sineWave) return SYNTH_WAVE_SINE;
+    return SYNTH_WAVE_OTHER;
+}
+
+//scalar versions, also used for the leftover samples at the end of a block
+static void synthWaveScalar(SynthWaveKind_t kind, const q15_t *phase, q15_t *out, int n) {
+    switch (kind) {
+        case SYNTH_WAVE_SAWTOOTH:
+            for (int t = 0; t < n; t++) out[t] = sawtoothWaveInline(phase[t]);
+            break;
+        case SYNTH_WAVE_FALLING:
+            for (int t = 0; t < n; t++) out[t] = fallingWaveInline(phase[t]);
+            break;
+        case SYNTH_WAVE_TRIANGLE:
+            for (int t = 0; t < n; t++) out[t] = triangleWaveInline(phase[t]);
+            break;
+        case SYNTH_WAVE_SQUARE:
+            for (int t = 0; t < n; t++) out[t] = squareWaveInline(phase[t]);
+            break;
+        case SYNTH_WAVE_EXP_DECAY:
+            for (int t = 0; t < n; t++) out[t] = expDecayWaveInline(phase[t]);
+            break;
+        case SYNTH_WAVE_SINE:
+            for (int t = 0; t < n; t++) out[t] = sineWaveInline(phase[t]);
+            break;
+        default:
+            break;
+    }
+}
+
+static void synthGainScalar(q15_t *out, const q15_t *gain, int gainStep, int n) {
+    for (int t = 0; t < n; t++) {
+        out[t] = (out[t] * *gain) >> 15;
+        gain += gainStep;
+    }
+}
+
+static void synthMixScalar(q15_t *out, const q15_t **inputs, const int *steps, const q15_t *gain, int gainStep, int n) {
+    for (int t = 0; t < n; t++) {
+        int32_t sum = 0;
+        for (int j = 0; j < 3; j++) {
+            if (inputs[j]) {
+                sum += *inputs[j];
+                inputs[j] += steps[j];
+            }
+        }
+        if (gain) {
+            sum = (sum * *gain) >> 15;
+            gain += gainStep;
+        }
+        out[t] = sum;
+    }
+}
+
+
+#if SYNTH_SIMD_SSE2
+//(a * b) >> 15 for 8 q15 lanes. the low 16 bits of the full product shifted, same as the scalar code
+static inline __m128i synthMulQ15Sse2(__m128i a, __m128i b) {
+    __m128i hi = _mm_mulhi_epi16(a, b);
+    __m128i lo = _mm_mullo_epi16(a, b);
+    return _mm_or_si128(_mm_slli_epi16(hi, 1), _mm_srli_epi16(lo, 15));
+}
+
+//phases are 0 to Q15_MAX, any wrap around in 16 bit lanes lands on the same result the scalar code truncates to
+static inline __m128i synthWaveSse2(SynthWaveKind_t kind, __m128i x) {
+    const __m128i max = _mm_set1_epi16(Q15_MAX);
+    switch (kind) {
+        case SYNTH_WAVE_SAWTOOTH:
+            return _mm_sub_epi16(_mm_add_epi16(x, x), max);
+        case SYNTH_WAVE_FALLING:
+            return _mm_sub_epi16(max, _mm_add_epi16(x, x));
+        case SYNTH_WAVE_TRIANGLE: {
+            __m128i r = _mm_add_epi16(x, x);
+            __m128i over = _mm_cmplt_epi16(r, _mm_setzero_si128()); //went past Q15_MAX
+            __m128i folded = _mm_sub_epi16(_mm_set1_epi16(-2), r); //Q15_MAX - (r - Q15_MAX)
+            r = _mm_or_si128(_mm_and_si128(over, folded), _mm_andnot_si128(over, r));
+            return _mm_sub_epi16(_mm_add_epi16(r, r), max);
+        }
+        case SYNTH_WAVE_SQUARE: {
+            __m128i low = _mm_cmplt_epi16(x, _mm_set1_epi16(Q15_MAX / 2));
+            return _mm_xor_si128(low, _mm_set1_epi16((short) Q15_MIN)); //all ones ^ 0x8000 = Q15_MAX
+        }
+        default: { //SYNTH_WAVE_EXP_DECAY
+            __m128i v = _mm_sub_epi16(max, x);
+            v = synthMulQ15Sse2(v, v);
+            return synthMulQ15Sse2(v, v);
+        }
+    }
+}
+#endif
+
+#if SYNTH_SIMD_AVX2
+SYNTH_AVX2_TARGET
+static inline __m256i synthMulQ15Avx2(__m256i a, __m256i b) {
+    __m256i hi = _mm256_mulhi_epi16(a, b);
+    __m256i lo = _mm256_mullo_epi16(a, b);
+    return _mm256_or_si256(_mm256_slli_epi16(hi, 1), _mm256_srli_epi16(lo, 15));
+}
+
+SYNTH_AVX2_TARGET
+static inline __m256i synthWaveAvx2(SynthWaveKind_t kind, __m256i x) {
+    const __m256i max = _mm256_set1_epi16(Q15_MAX);
+    switch (kind) {
+        case SYNTH_WAVE_SAWTOOTH:
+            return _mm256_sub_epi16(_mm256_add_epi16(x, x), max);
+        case SYNTH_WAVE_FALLING:
+            return _mm256_sub_epi16(max, _mm256_add_epi16(x, x));
+        case SYNTH_WAVE_TRIANGLE: {
+            __m256i r = _mm256_add_epi16(x, x);
+            __m256i over = _mm256_cmpgt_epi16(_mm256_setzero_si256(), r);
+            __m256i folded = _mm256_sub_epi16(_mm256_set1_epi16(-2), r);
+            r = _mm256_blendv_epi8(r, folded, over);
+            return _mm256_sub_epi16(_mm256_add_epi16(r, r), max);
+        }
+        case SYNTH_WAVE_SQUARE: {
+            __m256i low = _mm256_cmpgt_epi16(_mm256_set1_epi16(Q15_MAX / 2), x);
+            return _mm256_xor_si256(low, _mm256_set1_epi16((short) Q15_MIN));
+        }
+        default: {
+            __m256i v = _mm256_sub_epi16(max, x);
+            v = synthMulQ15Avx2(v, v);
+            return synthMulQ15Avx2(v, v);
+        }
+    }
+}
+
+SYNTH_AVX2_TARGET
+static int synthWaveBlockAvx2(SynthWaveKind_t kind, const q15_t *phase, q15_t *out, int n) {
+    int t = 0;
+    for (; t + 16 <= n; t += 16) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (phase + t));
+        _mm256_storeu_si256((__m256i *) (out + t), synthWaveAvx2(kind, x));
+    }
+    return t;
+}
+
+SYNTH_AVX2_TARGET
+static int synthGainBlockAvx2(q15_t *out, const q15_t *gain, int gainStep, int n) {
+    int t = 0;
+    __m256i g = _mm256_set1_epi16(*gain);
+    for (; t + 16 <= n; t += 16) {
+        if (gainStep) {
+            g = _mm256_loadu_si256((const __m256i *) (gain + t));
+        }
+        __m256i x = _mm256_loadu_si256((const __m256i *) (out + t));
+        _mm256_storeu_si256((__m256i *) (out + t), synthMulQ15Avx2(x, g));
+    }
+    return t;
+}
+
+//8 samples of an input sign extended to 32 bits
+SYNTH_AVX2_TARGET
+static inline __m256i synthLoadWideAvx2(const q15_t *p, int step, int t) {
+    if (!p) {
+        return _mm256_setzero_si256();
+    }
+    if (!step) {
+        return _mm256_set1_epi32(*p);
+    }
+    return _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (p + t)));
+}
+
+SYNTH_AVX2_TARGET
+static int synthMixBlockAvx2(q15_t *out, const q15_t *const *inputs, const int *steps, const q15_t *gain, int gainStep, int n) {
+    int t = 0;
+    for (; t + 16 <= n; t += 16) {
+        __m256i res[2];
+        for (int half = 0; half < 2; half++) {
+            int at = t + half * 8;
+            __m256i sum = _mm256_add_epi32(synthLoadWideAvx2(inputs[0], steps[0], at), synthLoadWideAvx2(inputs[1], steps[1], at));
+            sum = _mm256_add_epi32(sum, synthLoadWideAvx2(inputs[2], steps[2], at));
+            if (gain) {
+                sum = _mm256_srai_epi32(_mm256_mullo_epi32(sum, synthLoadWideAvx2(gain, gainStep, at)), 15);
+            }
+            //keep the low 16 bits, like storing to a q15
+            res[half] = _mm256_and_si256(sum, _mm256_set1_epi32(0xFFFF));
+        }
+        __m256i packed = _mm256_packus_epi32(res[0], res[1]);
+        packed = _mm256_permute4x64_epi64(packed, 0xD8); //pack works within 128 bit lanes, put them back in order
+        _mm256_storeu_si256((__m256i *) (out + t), packed);
+    }
+    return t;
+}
+
+static int synthHasAvx2() {
+#ifdef __AVX2__
+    return 1;
+#else
+    static int hasAvx2 = -1;
+    if (hasAvx2 < 0) {
+        hasAvx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return hasAvx2;
+#endif
+}
+#endif //SYNTH_SIMD_AVX2
+
+#if SYNTH_SIMD_NEON
+static inline int16x8_t synthMulQ15Neon(int16x8_t a, int16x8_t b) {
+    int32x4_t lo = vmull_s16(vget_low_s16(a), vget_low_s16(b));
+    int32x4_t hi = vmull_s16(vget_high_s16(a), vget_high_s16(b));
+    return vcombine_s16(vshrn_n_s32(lo, 15), vshrn_n_s32(hi, 15));
+}
+
+static inline int16x8_t synthWaveNeon(SynthWaveKind_t kind, int16x8_t x) {
+    const int16x8_t max = vdupq_n_s16(Q15_MAX);
+    switch (kind) {
+        case SYNTH_WAVE_SAWTOOTH:
+            return vsubq_s16(vaddq_s16(x, x), max);
+        case SYNTH_WAVE_FALLING:
+            return vsubq_s16(max, vaddq_s16(x, x));
+        case SYNTH_WAVE_TRIANGLE: {
+            int16x8_t r = vaddq_s16(x, x);
+            uint16x8_t over = vcltq_s16(r, vdupq_n_s16(0));
+            r = vbslq_s16(over, vsubq_s16(vdupq_n_s16(-2), r), r);
+            return vsubq_s16(vaddq_s16(r, r), max);
+        }
+        case SYNTH_WAVE_SQUARE:
+            return vbslq_s16(vcltq_s16(x, vdupq_n_s16(Q15_MAX / 2)), max, vdupq_n_s16(-32768));
+        default: {
+            int16x8_t v = vsubq_s16(max, x);
+            v = synthMulQ15Neon(v, v);
+            return synthMulQ15Neon(v, v);
+        }
+    }
+}
+
+static inline int32x4_t synthLoadWideNeon(const q15_t *p, int step, int t) {
+    if (!p) {
+        return vdupq_n_s32(0);
+    }
+    if (!step) {
+        return vdupq_n_s32(*p);
+    }
+    return vmovl_s16(vld1_s16(p + t));
+}
+#endif //SYNTH_SIMD_NEON
+
+
+int synthWaveBlock(q15_t (*wavegen)(q15_t input), const q15_t *phase, q15_t *out, int n) {
+    SynthWaveKind_t kind = synthWaveKind(wavegen);
+    if (kind == SYNTH_WAVE_OTHER) {
+        return 0;
+    }
+    int t = 0;
+    //the sine lut lookup doesn't vectorize, it still gets the call inlined
+    if (kind != SYNTH_WAVE_SINE) {
+#if SYNTH_SIMD_AVX2
+        if (synthHasAvx2()) {
+            t = synthWaveBlockAvx2(kind, phase, out, n);
+        }
+#endif
+#if SYNTH_SIMD_SSE2
+        for (; t + 8 <= n; t += 8) {
+            __m128i x = _mm_loadu_si128((const __m128i *) (phase + t));
+            _mm_storeu_si128((__m128i *) (out + t), synthWaveSse2(kind, x));
+        }
+#elif SYNTH_SIMD_NEON
+        for (; t + 8 <= n; t += 8) {
+            vst1q_s16(out + t, synthWaveNeon(kind, vld1q_s16(phase + t)));
+        }
+#elif SYNTH_SIMD_DSP
+        if (kind == SYNTH_WAVE_SAWTOOTH || kind == SYNTH_WAVE_FALLING) {
+            const int16x2_t max = 0x7FFF7FFF;
+            for (; t + 2 <= n; t += 2) {
+                int16x2_t x;
+                memcpy(&x, phase + t, sizeof(x));
+                x = __sadd16(x, x);
+                x = kind == SYNTH_WAVE_SAWTOOTH ? __ssub16(x, max) : __ssub16(max, x);
+                memcpy(out + t, &x, sizeof(x));
+            }
+        }
+#endif
+    }
+    synthWaveScalar(kind, phase + t, out + t, n - t);
+    return 1;
+}
+
+void synthGainBlock(q15_t *out, const q15_t *gain, int gainStep, int n) {
+    int t = 0;
+#if SYNTH_SIMD_AVX2
+    if (synthHasAvx2()) {
+        t = synthGainBlockAvx2(out, gain, gainStep, n);
+    }
+#endif
+#if SYNTH_SIMD_SSE2
+    __m128i g = _mm_set1_epi16(*gain);
+    for (; t + 8 <= n; t += 8) {
+        if (gainStep) {
+            g = _mm_loadu_si128((const __m128i *) (gain + t));
+        }
+        __m128i x = _mm_loadu_si128((const __m128i *) (out + t));
+        _mm_storeu_si128((__m128i *) (out + t), synthMulQ15Sse2(x, g));
+    }
+#elif SYNTH_SIMD_NEON
+    int16x8_t g = vdupq_n_s16(*gain);
+    for (; t + 8 <= n; t += 8) {
+        if (gainStep) {
+            g = vld1q_s16(gain + t);
+        }
+        vst1q_s16(out + t, synthMulQ15Neon(vld1q_s16(out + t), g));
+    }
+#elif SYNTH_SIMD_DSP
+    for (; t + 2 <= n; t += 2) {
+        int16x2_t x, g;
+        memcpy(&x, out + t, sizeof(x));
+        if (gainStep) {
+            memcpy(&g, gain + t, sizeof(g));
+        } else {
+            g = (int16x2_t) ((uint16_t) *gain * 0x00010001u);
+        }
+        //SMULBB/SMULTT, a 16x16 multiply of each half
+        int32_t lo = __smulbb(x, g) >> 15;
+        int32_t hi = __smultt(x, g) >> 15;
+        x = (int16x2_t) (((uint32_t) lo & 0xFFFF) | ((uint32_t) hi << 16));
+        memcpy(out + t, &x, sizeof(x));
+    }
+#endif
+    synthGainScalar(out + t, gain + t * gainStep, gainStep, n - t);
+}
+
+void synthMixBlock(q15_t *out, const q15_t *const *inputs, const int *steps, const q15_t *gain, int gainStep, int n) {
+    int t = 0;
+#if SYNTH_SIMD_AVX2
+    if (synthHasAvx2()) {
+        t = synthMixBlockAvx2(out, inputs, steps, gain, gainStep, n);
+    }
+#endif
+#if SYNTH_SIMD_SSE2
+    if (!gain) {
+        //without gain the result is the low 16 bits of the sum, a wrapping 16 bit add
+        for (; t + 8 <= n; t += 8) {
+            __m128i sum = _mm_setzero_si128();
+            for (int j = 0; j < 3; j++) {
+                if (inputs[j]) {
+                    __m128i x = steps[j] ? _mm_loadu_si128((const __m128i *) (inputs[j] + t)) : _mm_set1_epi16(*inputs[j]);
+                    sum = _mm_add_epi16(sum, x);
+                }
+            }
+            _mm_storeu_si128((__m128i *) (out + t), sum);
+        }
+    }
+#elif SYNTH_SIMD_NEON
+    for (; t + 4 <= n; t += 4) {
+        int32x4_t sum = vaddq_s32(synthLoadWideNeon(inputs[0], steps[0], t), synthLoadWideNeon(inputs[1], steps[1], t));
+        sum = vaddq_s32(sum, synthLoadWideNeon(inputs[2], steps[2], t));
+        if (gain) {
+            sum = vshrq_n_s32(vmulq_s32(sum, synthLoadWideNeon(gain, gainStep, t)), 15);
+        }
+        vst1_s16(out + t, vmovn_s32(sum));
+    }
+#endif
+    const q15_t *rest[3];
+    for (int j = 0; j < 3; j++) {
+        rest[j] = inputs[j] ? inputs[j] + t * steps[j] : NULL;
+    }
+    synthMixScalar(out + t, rest, steps, gain ? gain + t * gainStep : NULL, gainStep, n - t);
+}
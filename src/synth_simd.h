@@ -0,0 +1,18 @@
+//block kernels for the hot loops, with SIMD versions where the target supports them:
+//SSE2 and AVX2 (picked at runtime) on x86, NEON, and the ARMv7E-M DSP extension on Cortex-M4 class parts.
+//all of them give exactly the same results as the scalar code in synth.c
+#ifndef __SYNTH_SIMD_H
+#define __SYNTH_SIMD_H
+
+#include "synth.h"
+
+//out[t] = wavegen(phase[t]) for the built in wave generators. returns 0 if there's no kernel for wavegen
+int synthWaveBlock(q15_t (*wavegen)(q15_t input), const q15_t *phase, q15_t *out, int n);
+
+//out[t] = (out[t] * gain) >> 15, gain advances by gainStep (0 or 1) each sample
+void synthGainBlock(q15_t *out, const q15_t *gain, int gainStep, int n);
+
+//out[t] = (sum of the inputs * gain) >> 15. inputs and gain can be NULL, and advance by their step (0 or 1)
+void synthMixBlock(q15_t *out, const q15_t *const *inputs, const int *steps, const q15_t *gain, int gainStep, int n);
+
+#endif // __SYNTH_SIMD_H
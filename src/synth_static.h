@@ -0,0 +1,248 @@
+//compiled patches: describe a voice's nodes with an X-macro and get a render function with the node types
+//and wiring baked in. no type dispatch, pointer chasing or wavegen calls per sample, and node state stays in
+//locals for the whole block so the compiler can keep it in registers.
+#ifndef __SYNTH_STATIC_H
+#define __SYNTH_STATIC_H
+
+#include "synth.h"
+#include "synth_inline.h"
+
+//a patch is a macro that takes X, with one X(...) per node, listed in the order they run (nodes after the nodes
+//they read from, see synthVoiceSchedule), with the voice's output at index 0:
+//  X(OSCILLATOR, index, gain, phaseIncrement, detune, wavegen)
+//  X(OSCILLATOR_BL, index, gain, phaseIncrement, detune, wavegen)
+//  X(WAVETABLE, index, gain, phaseIncrement, detune, table, position)
+//  X(ENVELOPE, index, gain, attack, decay, sustain, release)
+//  X(FILTER_LP, index, gain, input, factor)
+//  X(FILTER_HP, index, gain, input, factor)
+//  X(MIXER, index, gain, input1, input2, input3)
+//  X(FILTER_SVF, index, gain, input, cutoff, resonance, mode)
+//  X(NOISE, index, gain, seed)
+//  X(DELAY, index, gain, input, time, feedback)
+//inputs are NODE(i) for another node's output in the same voice, TAP(i, output) for one of a FILTER_SVF's responses
+//(e.g. TAP(2, SYNTH_SVF_BP)), EXT(pointer) for anything else, or NONE.
+//"voice" can be used in EXT, e.g. EXT(&voice->phaseIncrement).
+//wavegen is a wave generator function (band limited for OSCILLATOR_BL, e.g. sawtoothWaveBl), the render calls its Inline version (e.g. sawtoothWaveInline).
+//table is a pointer to a SynthWavetable_t, e.g. &myBank.
+//delays take their line from the voice's instance's pool, voice->synth->delayPool.
+//
+//SYNTH_STATIC_VOICE(name, PATCH) then defines:
+//  void name##Init(SynthVoice_t *voice)
+//      wires up the voice's nodes, same as the equivalent synthInit*Node calls. give the voice at least as many nodes
+//      as the highest node index + 1 with synthVoiceAlloc first.
+//  void name##Render(SynthVoice_t *voice, int32_t *mix, int n)
+//      adds n samples of the voice into mix, exactly what synthProcess() would have produced for it.
+//      (for patches with feedback loops, as long as the list order matches the voice's schedule)
+//      mix can be turned into output samples with synthMixdown(synth, ...).
+//
+//every node runs at audio rate, so don't use synthNodeSetRate or synthVoiceSetOversample on these voices.
+//the voice is a normal SynthVoice_t, so note on/off and idle voice skipping work as usual and it can also be run by synthProcess().
+//example, an enveloped sawtooth through a low pass filter:
+/*
+    #define LEAD_PATCH(X) \
+        X(ENVELOPE, 1, NONE, 500, 150, Q15_MAX * .8, 150) \
+        X(OSCILLATOR, 2, NODE(1), EXT(&voice->phaseIncrement), NONE, sawtoothWave) \
+        X(FILTER_LP, 0, NONE, NODE(2), 8000)
+    SYNTH_STATIC_VOICE(lead, LEAD_PATCH)
+*/
+
+
+//input sources
+#define SYNTH_STATIC_HAS(src) SYNTH_STATIC_HAS_##src
+#define SYNTH_STATIC_HAS_NONE 0
+#define SYNTH_STATIC_HAS_NODE(i) 1
+#define SYNTH_STATIC_HAS_EXT(p) 1
+#define SYNTH_STATIC_HAS_TAP(i, k) 1
+
+#define SYNTH_STATIC_READ(src) SYNTH_STATIC_READ_##src
+#define SYNTH_STATIC_READ_NONE 0
+#define SYNTH_STATIC_READ_NODE(i) synthOut##i
+#define SYNTH_STATIC_READ_EXT(p) (*(p))
+#define SYNTH_STATIC_READ_TAP(i, k) synthTaps##i[k]
+
+#define SYNTH_STATIC_PTR(src) SYNTH_STATIC_PTR_##src
+#define SYNTH_STATIC_PTR_NONE NULL
+#define SYNTH_STATIC_PTR_NODE(i) (&voice->nodes[i].output)
+#define SYNTH_STATIC_PTR_EXT(p) (p)
+#define SYNTH_STATIC_PTR_TAP(i, k) (&voice->nodes[i].svf.outputs[k])
+
+#define SYNTH_STATIC_GAIN(i, gain) \
+    if (SYNTH_STATIC_HAS(gain)) { \
+        synthNext##i = (synthNext##i * SYNTH_STATIC_READ(gain)) >> 15; \
+    }
+
+
+//wire up the nodes
+#define SYNTH_STATIC_INIT(type, ...) SYNTH_STATIC_INIT_##type(__VA_ARGS__)
+#define SYNTH_STATIC_INIT_OSCILLATOR(i, gain, phaseIncrement, detune, wavegen) \
+    synthInitOscNode(&voice->nodes[i], SYNTH_STATIC_PTR(gain), SYNTH_STATIC_PTR(phaseIncrement), SYNTH_STATIC_PTR(detune), wavegen);
+#define SYNTH_STATIC_INIT_OSCILLATOR_BL(i, gain, phaseIncrement, detune, wavegen) \
+    synthInitOscBlNode(&voice->nodes[i], SYNTH_STATIC_PTR(gain), SYNTH_STATIC_PTR(phaseIncrement), SYNTH_STATIC_PTR(detune), wavegen);
+#define SYNTH_STATIC_INIT_WAVETABLE(i, gain, phaseIncrement, detune, table, position) \
+    synthInitWavetableNode(&voice->nodes[i], SYNTH_STATIC_PTR(gain), SYNTH_STATIC_PTR(phaseIncrement), SYNTH_STATIC_PTR(detune), table, SYNTH_STATIC_PTR(position));
+#define SYNTH_STATIC_INIT_ENVELOPE(i, gain, attack, decay, sustain, release) \
+    synthInitEnvelopeNode(&voice->nodes[i], SYNTH_STATIC_PTR(gain), attack, decay, sustain, release);
+#define SYNTH_STATIC_INIT_FILTER_LP(i, gain, input, factor) \
+    synthInitFilterLpNode(&voice->nodes[i], SYNTH_STATIC_PTR(gain), SYNTH_STATIC_PTR(input), factor);
+#define SYNTH_STATIC_INIT_FILTER_HP(i, gain, input, factor) \
+    synthInitFilterHpNode(&voice->nodes[i], SYNTH_STATIC_PTR(gain), SYNTH_STATIC_PTR(input), factor);
+#define SYNTH_STATIC_INIT_MIXER(i, gain, input1, input2, input3) \
+    synthInitMixerNode(&voice->nodes[i], SYNTH_STATIC_PTR(gain), SYNTH_STATIC_PTR(input1), SYNTH_STATIC_PTR(input2), SYNTH_STATIC_PTR(input3));
+
+#define SYNTH_STATIC_INIT_FILTER_SVF(i, gain, input, cutoff, resonance, mode) \
+    synthInitFilterSvfNode(&voice->nodes[i], SYNTH_STATIC_PTR(gain), SYNTH_STATIC_PTR(input), SYNTH_STATIC_PTR(cutoff), SYNTH_STATIC_PTR(resonance), mode);
+#define SYNTH_STATIC_INIT_NOISE(i, gain, seed) \
+    synthInitNoiseNode(&voice->nodes[i], SYNTH_STATIC_PTR(gain), seed);
+#define SYNTH_STATIC_INIT_DELAY(i, gain, input, time, feedback) \
+    synthInitDelayNode(&voice->nodes[i], SYNTH_STATIC_PTR(gain), SYNTH_STATIC_PTR(input), SYNTH_STATIC_PTR(time), \
+            SYNTH_STATIC_PTR(feedback), &voice->synth->delayPool);
+
+
+//load node state into locals
+#define SYNTH_STATIC_LOAD(type, ...) SYNTH_STATIC_LOAD_##type(__VA_ARGS__)
+#define SYNTH_STATIC_LOAD_OSCILLATOR(i, ...) \
+    q15_t synthOut##i = voice->nodes[i].output; int32_t synthState##i = voice->nodes[i].state; int32_t synthNext##i;
+#define SYNTH_STATIC_LOAD_OSCILLATOR_BL(i, ...) SYNTH_STATIC_LOAD_OSCILLATOR(i)
+#define SYNTH_STATIC_LOAD_WAVETABLE(i, ...) SYNTH_STATIC_LOAD_OSCILLATOR(i)
+#define SYNTH_STATIC_LOAD_ENVELOPE(i, ...) SYNTH_STATIC_LOAD_OSCILLATOR(i)
+#define SYNTH_STATIC_LOAD_NOISE(i, ...) SYNTH_STATIC_LOAD_OSCILLATOR(i)
+#define SYNTH_STATIC_LOAD_FILTER_LP(i, ...) \
+    q15_t synthOut##i = voice->nodes[i].output; int32_t synthState##i = voice->nodes[i].filter.accum; int32_t synthNext##i;
+#define SYNTH_STATIC_LOAD_FILTER_HP(i, ...) SYNTH_STATIC_LOAD_FILTER_LP(i)
+#define SYNTH_STATIC_LOAD_MIXER(i, ...) \
+    q15_t synthOut##i = voice->nodes[i].output; int32_t synthNext##i;
+#define SYNTH_STATIC_LOAD_DELAY(i, ...) \
+    q15_t synthOut##i = voice->nodes[i].output; int32_t synthState##i = voice->nodes[i].state; int32_t synthNext##i; \
+    SynthDelay_t synthDelay##i = voice->nodes[i].delay;
+
+#define SYNTH_STATIC_LOAD_FILTER_SVF(i, ...) \
+    q15_t synthOut##i = voice->nodes[i].output; int32_t synthNext##i; \
+    int32_t synthLow##i = voice->nodes[i].svf.low; int32_t synthBand##i = voice->nodes[i].svf.band; \
+    q15_t synthTaps##i[4] = {voice->nodes[i].svf.outputs[0], voice->nodes[i].svf.outputs[1], \
+        voice->nodes[i].svf.outputs[2], voice->nodes[i].svf.outputs[3]};
+
+
+//run a node for one sample
+#define SYNTH_STATIC_STEP(type, ...) SYNTH_STATIC_OUTPUT_##type(__VA_ARGS__) SYNTH_STATIC_UPDATE_##type(__VA_ARGS__)
+
+//generate output from current state
+#define SYNTH_STATIC_OUTPUT_OSCILLATOR(i, gain, phaseIncrement, detune, wavegen) \
+    synthNext##i = wavegen##Inline(synthPhaseWave(synthState##i)); \
+    SYNTH_STATIC_GAIN(i, gain)
+#define SYNTH_STATIC_OUTPUT_OSCILLATOR_BL(i, gain, phaseIncrement, detune, wavegen) \
+    synthNext##i = wavegen##Inline(synthPhaseWave(synthState##i), \
+            (q15_t) (synthPhaseIncrement15(SYNTH_STATIC_READ(phaseIncrement)) + SYNTH_STATIC_READ(detune))); \
+    SYNTH_STATIC_GAIN(i, gain)
+#define SYNTH_STATIC_OUTPUT_WAVETABLE(i, gain, phaseIncrement, detune, table, position) \
+    synthNext##i = synthWavetableLookup(table, synthPhaseWave(synthState##i), SYNTH_STATIC_READ(position)); \
+    SYNTH_STATIC_GAIN(i, gain)
+#define SYNTH_STATIC_OUTPUT_ENVELOPE(i, gain, attack, decay, sustain, release) \
+    synthNext##i = synthEnvelopeOutput(synthState##i, (q15_t) (sustain)); \
+    SYNTH_STATIC_GAIN(i, gain)
+#define SYNTH_STATIC_OUTPUT_FILTER_LP(i, gain, input, factor) \
+    synthNext##i = (synthState##i * (int32_t) (q15_t) (factor)) >> 15; \
+    SYNTH_STATIC_GAIN(i, gain)
+#define SYNTH_STATIC_OUTPUT_FILTER_HP(i, gain, input, factor) \
+    synthNext##i = (synthState##i * (int32_t) (q15_t) (factor)) >> 15; \
+    synthNext##i = SYNTH_STATIC_READ(input) - synthNext##i; \
+    SYNTH_STATIC_GAIN(i, gain)
+#define SYNTH_STATIC_OUTPUT_MIXER(i, gain, input1, input2, input3) \
+    synthNext##i = SYNTH_STATIC_READ(input1) + SYNTH_STATIC_READ(input2) + SYNTH_STATIC_READ(input3); \
+    SYNTH_STATIC_GAIN(i, gain)
+#define SYNTH_STATIC_OUTPUT_NOISE(i, gain, seed) \
+    synthNext##i = synthNoiseOutput(synthState##i); \
+    SYNTH_STATIC_GAIN(i, gain)
+//the line is read and written here, a pool that ran out of lines leaves it silent
+#define SYNTH_STATIC_OUTPUT_DELAY(i, gain, input, time, feedback) \
+    synthNext##i = synthDelay##i.line ? synthDelayStep(&synthDelay##i, &synthState##i, SYNTH_STATIC_READ(input), \
+            SYNTH_STATIC_READ(time), SYNTH_STATIC_READ(feedback)) : 0; \
+    SYNTH_STATIC_GAIN(i, gain)
+
+//the filter runs on this sample's input, so its state is updated here. gain applies to every response
+#define SYNTH_STATIC_OUTPUT_FILTER_SVF(i, gain, input, cutoff, resonance, mode) \
+    { \
+        int32_t synthResponses[4]; \
+        synthSvfStep(&synthLow##i, &synthBand##i, SYNTH_STATIC_READ(input), synthSvfCutoff(SYNTH_STATIC_READ(cutoff)), \
+                synthSvfDamping(SYNTH_STATIC_READ(resonance)), synthResponses); \
+        for (int k = 0; k < 4; k++) { \
+            synthNext##i = synthClampQ15(synthResponses[k]); \
+            SYNTH_STATIC_GAIN(i, gain) \
+            synthTaps##i[k] = synthNext##i; \
+        } \
+        synthNext##i = synthTaps##i[mode]; \
+    }
+
+
+//commit output and update state
+#define SYNTH_STATIC_UPDATE_OSCILLATOR(i, gain, phaseIncrement, detune, wavegen) \
+    synthOut##i = synthNext##i; \
+    synthState##i = synthPhaseStep(synthState##i, SYNTH_STATIC_READ(phaseIncrement), SYNTH_STATIC_READ(detune));
+#define SYNTH_STATIC_UPDATE_OSCILLATOR_BL(i, gain, phaseIncrement, detune, wavegen) \
+    SYNTH_STATIC_UPDATE_OSCILLATOR(i, gain, phaseIncrement, detune, wavegen)
+#define SYNTH_STATIC_UPDATE_WAVETABLE(i, gain, phaseIncrement, detune, table, position) \
+    SYNTH_STATIC_UPDATE_OSCILLATOR(i, gain, phaseIncrement, detune, table)
+#define SYNTH_STATIC_UPDATE_ENVELOPE(i, gain, attack, decay, sustain, release) \
+    synthOut##i = synthNext##i; \
+    synthState##i = synthEnvelopeStep(synthState##i, gate, attack, decay, sustain, release);
+#define SYNTH_STATIC_UPDATE_FILTER_LP(i, gain, input, factor) \
+    synthOut##i = synthNext##i; \
+    synthState##i += SYNTH_STATIC_READ(input) - synthOut##i;
+#define SYNTH_STATIC_UPDATE_FILTER_HP(i, gain, input, factor) SYNTH_STATIC_UPDATE_FILTER_LP(i, gain, input, factor)
+#define SYNTH_STATIC_UPDATE_MIXER(i, ...) \
+    synthOut##i = synthNext##i;
+#define SYNTH_STATIC_UPDATE_NOISE(i, ...) \
+    synthOut##i = synthNext##i; \
+    synthState##i = synthNoiseStep(synthState##i);
+
+#define SYNTH_STATIC_UPDATE_FILTER_SVF(i, ...) \
+    synthOut##i = synthNext##i;
+#define SYNTH_STATIC_UPDATE_DELAY(i, ...) \
+    synthOut##i = synthNext##i;
+
+
+//write locals back to the nodes
+#define SYNTH_STATIC_STORE(type, ...) SYNTH_STATIC_STORE_##type(__VA_ARGS__)
+#define SYNTH_STATIC_STORE_OSCILLATOR(i, ...) \
+    voice->nodes[i].output = synthOut##i; voice->nodes[i].state = synthState##i;
+#define SYNTH_STATIC_STORE_OSCILLATOR_BL(i, ...) SYNTH_STATIC_STORE_OSCILLATOR(i)
+#define SYNTH_STATIC_STORE_WAVETABLE(i, ...) SYNTH_STATIC_STORE_OSCILLATOR(i)
+#define SYNTH_STATIC_STORE_ENVELOPE(i, ...) SYNTH_STATIC_STORE_OSCILLATOR(i)
+#define SYNTH_STATIC_STORE_NOISE(i, ...) SYNTH_STATIC_STORE_OSCILLATOR(i)
+#define SYNTH_STATIC_STORE_FILTER_LP(i, ...) \
+    voice->nodes[i].output = synthOut##i; voice->nodes[i].filter.accum = synthState##i;
+#define SYNTH_STATIC_STORE_FILTER_HP(i, ...) SYNTH_STATIC_STORE_FILTER_LP(i)
+#define SYNTH_STATIC_STORE_MIXER(i, ...) \
+    voice->nodes[i].output = synthOut##i;
+#define SYNTH_STATIC_STORE_DELAY(i, ...) \
+    voice->nodes[i].output = synthOut##i; voice->nodes[i].state = synthState##i; voice->nodes[i].delay.pos = synthDelay##i.pos;
+
+#define SYNTH_STATIC_STORE_FILTER_SVF(i, ...) \
+    voice->nodes[i].output = synthOut##i; voice->nodes[i].svf.low = synthLow##i; voice->nodes[i].svf.band = synthBand##i; \
+    for (int k = 0; k < 4; k++) { \
+        voice->nodes[i].svf.outputs[k] = synthTaps##i[k]; \
+    }
+
+
+#define SYNTH_STATIC_VOICE(name, PATCH) \
+static void name##Init(SynthVoice_t *voice) { \
+    PATCH(SYNTH_STATIC_INIT) \
+} \
+static void name##Render(SynthVoice_t *voice, int32_t *mix, int n) { \
+    if (voice->idle) { \
+        return; \
+    } \
+    const int gate = voice->gate; \
+    (void) gate; \
+    PATCH(SYNTH_STATIC_LOAD) \
+    for (int t = 0; t < n; t++) { \
+        synthVoiceGlideStep(voice); \
+        PATCH(SYNTH_STATIC_STEP) \
+        mix[t] += synthOut0; \
+    } \
+    PATCH(SYNTH_STATIC_STORE) \
+    if (!gate) { \
+        synthVoiceCheckIdle(voice); \
+    } \
+}
+
+#endif // __SYNTH_STATIC_H
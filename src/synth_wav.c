@@ -0,0 +1,212 @@
+//host only: stream rendered audio to a wav file, raw pcm, or stdout with fixed memory
+
+#include "synth_wav.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include <pthread.h>
+
+#define SYNTH_WAV_HEADER_SIZE 44
+
+struct SynthWavWriter {
+    FILE *file;
+    SynthWavFormat_t format;
+    uint64_t samples;
+
+    q15_t buffers[2][SYNTH_WAV_BUFFER];
+    size_t fill[2];
+    int current; //buffer being filled
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t ready; //a buffer was handed over, or quit
+    pthread_cond_t written; //the handed over buffer is written
+    int pending; //buffer waiting for or being written, -1 if none
+    int quit;
+    int error; //set by the writer thread
+    int failed; //copy of error for the rendering thread
+};
+
+static void synthWavPut16(uint8_t *p, uint16_t value) {
+    p[0] = value;
+    p[1] = value >> 8;
+}
+
+static void synthWavPut32(uint8_t *p, uint32_t value) {
+    synthWavPut16(p, value);
+    synthWavPut16(p + 2, value >> 16);
+}
+
+static void synthWavHeader(uint8_t *header, uint64_t samples) {
+    uint64_t dataSize = samples * 2;
+    if (dataSize > 0xFFFFFFFF - 36) {
+        dataSize = 0xFFFFFFFF - 36; //as big as a wav file gets
+    }
+    memcpy(header, "RIFF", 4);
+    synthWavPut32(header + 4, dataSize + 36);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    synthWavPut32(header + 16, 16); //fmt size
+    synthWavPut16(header + 20, 1); //pcm
+    synthWavPut16(header + 22, 1); //channels
+    synthWavPut32(header + 24, SAMPLE_RATE);
+    synthWavPut32(header + 28, SAMPLE_RATE * 2); //byte rate
+    synthWavPut16(header + 32, 2); //block align
+    synthWavPut16(header + 34, 16); //bits per sample
+    memcpy(header + 36, "data", 4);
+    synthWavPut32(header + 40, dataSize);
+}
+
+static void *synthWavThread(void *arg) {
+    SynthWavWriter_t *writer = arg;
+    pthread_mutex_lock(&writer->lock);
+    for (;;) {
+        while (writer->pending < 0 && !writer->quit) {
+            pthread_cond_wait(&writer->ready, &writer->lock);
+        }
+        if (writer->pending < 0) {
+            break;
+        }
+        int b = writer->pending;
+        pthread_mutex_unlock(&writer->lock);
+
+        if (writer->format == SYNTH_WAV_FILE) {
+            //wav samples are little endian whatever the host is, put each one's bytes in order in place
+            uint8_t *bytes = (uint8_t *) writer->buffers[b];
+            for (size_t k = 0; k < writer->fill[b]; k++) {
+                synthWavPut16(&bytes[2 * k], writer->buffers[b][k]);
+            }
+        }
+        size_t count = fwrite(writer->buffers[b], sizeof(q15_t), writer->fill[b], writer->file);
+
+        pthread_mutex_lock(&writer->lock);
+        if (count != writer->fill[b]) {
+            writer->error = 1;
+        }
+        writer->pending = -1;
+        pthread_cond_signal(&writer->written);
+    }
+    pthread_mutex_unlock(&writer->lock);
+    return NULL;
+}
+
+SynthWavWriter_t *synthWavOpen(const char *filename, SynthWavFormat_t format) {
+    SynthWavWriter_t *writer = calloc(1, sizeof(SynthWavWriter_t));
+    if (!writer) {
+        return NULL;
+    }
+    writer->file = strcmp(filename, "-") ? fopen(filename, "wb") : stdout;
+    if (!writer->file) {
+        free(writer);
+        return NULL;
+    }
+    writer->format = format;
+    writer->pending = -1;
+    if (format == SYNTH_WAV_FILE) {
+        //sizes are unknown until close, start with the maximum so streams that can't seek back still play
+        uint8_t header[SYNTH_WAV_HEADER_SIZE];
+        synthWavHeader(header, UINT64_MAX / 4);
+        if (fwrite(header, 1, sizeof(header), writer->file) != sizeof(header)) {
+            writer->error = writer->failed = 1;
+        }
+    }
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->ready, NULL);
+    pthread_cond_init(&writer->written, NULL);
+    if (pthread_create(&writer->thread, NULL, synthWavThread, writer)) {
+        pthread_mutex_destroy(&writer->lock);
+        pthread_cond_destroy(&writer->ready);
+        pthread_cond_destroy(&writer->written);
+        if (writer->file != stdout) {
+            fclose(writer->file);
+        }
+        free(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+//hand the current buffer to the writer thread, once it's done with the other one
+static void synthWavSubmit(SynthWavWriter_t *writer) {
+    pthread_mutex_lock(&writer->lock);
+    while (writer->pending >= 0) {
+        pthread_cond_wait(&writer->written, &writer->lock);
+    }
+    if (writer->fill[writer->current]) {
+        writer->pending = writer->current;
+        pthread_cond_signal(&writer->ready);
+        writer->current ^= 1;
+        writer->fill[writer->current] = 0;
+    }
+    writer->failed = writer->error;
+    pthread_mutex_unlock(&writer->lock);
+}
+
+int synthWavWrite(SynthWavWriter_t *writer, const q15_t *samples, size_t n) {
+    while (n > 0) {
+        size_t fill = writer->fill[writer->current];
+        size_t count = SYNTH_WAV_BUFFER - fill;
+        if (count > n) {
+            count = n;
+        }
+        memcpy(&writer->buffers[writer->current][fill], samples, count * sizeof(q15_t));
+        writer->fill[writer->current] += count;
+        writer->samples += count;
+        samples += count;
+        n -= count;
+        if (writer->fill[writer->current] == SYNTH_WAV_BUFFER) {
+            synthWavSubmit(writer);
+        }
+    }
+    return writer->failed;
+}
+
+int synthWavRender(SynthWavWriter_t *writer, Synth_t *synth, size_t n) {
+    while (n > 0) {
+        size_t fill = writer->fill[writer->current];
+        size_t count = SYNTH_WAV_BUFFER - fill;
+        if (count > n) {
+            count = n;
+        }
+        synthProcessBlock(synth, &writer->buffers[writer->current][fill], count);
+        writer->fill[writer->current] += count;
+        writer->samples += count;
+        n -= count;
+        if (writer->fill[writer->current] == SYNTH_WAV_BUFFER) {
+            synthWavSubmit(writer);
+        }
+    }
+    return writer->failed;
+}
+
+uint64_t synthWavSamples(SynthWavWriter_t *writer) {
+    return writer->samples;
+}
+
+int synthWavClose(SynthWavWriter_t *writer) {
+    synthWavSubmit(writer);
+    pthread_mutex_lock(&writer->lock);
+    writer->quit = 1;
+    pthread_cond_signal(&writer->ready);
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->thread, NULL);
+
+    int res = writer->error;
+    //patch in the real sizes if we can seek back to the header
+    if (writer->format == SYNTH_WAV_FILE && writer->file != stdout && fseek(writer->file, 0, SEEK_SET) == 0) {
+        uint8_t header[SYNTH_WAV_HEADER_SIZE];
+        synthWavHeader(header, writer->samples);
+        if (fwrite(header, 1, sizeof(header), writer->file) != sizeof(header)) {
+            res = 1;
+        }
+    }
+    if (writer->file == stdout) {
+        res |= fflush(stdout) != 0;
+    } else {
+        res |= fclose(writer->file) != 0;
+    }
+    pthread_mutex_destroy(&writer->lock);
+    pthread_cond_destroy(&writer->ready);
+    pthread_cond_destroy(&writer->written);
+    free(writer);
+    return res;
+}
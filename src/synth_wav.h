@@ -0,0 +1,37 @@
+//host only: stream rendered audio to a wav file, raw pcm, or stdout with fixed memory.
+//samples are collected in one of two buffers while the other is written out on a background thread,
+//so memory use doesn't grow with the length of the render and file writes overlap with rendering
+#ifndef __SYNTH_WAV_H
+#define __SYNTH_WAV_H
+
+#include "synth.h"
+
+//samples per buffer, there are two
+#ifndef SYNTH_WAV_BUFFER
+#define SYNTH_WAV_BUFFER 8192
+#endif
+
+typedef enum SynthWavFormat {
+    SYNTH_WAV_FILE, //16 bit mono wav at SAMPLE_RATE
+    SYNTH_WAV_RAW, //headerless 16 bit mono pcm in host byte order
+} SynthWavFormat_t;
+
+typedef struct SynthWavWriter SynthWavWriter_t;
+
+//open filename for writing, or stdout if it is "-". returns NULL if it can't be opened.
+//wav sizes are patched in on close, except on stdout where they are left at the maximum
+SynthWavWriter_t *synthWavOpen(const char *filename, SynthWavFormat_t format);
+
+//append n samples. returns 0, or 1 if a write has failed
+int synthWavWrite(SynthWavWriter_t *writer, const q15_t *samples, size_t n);
+
+//render n samples of synth with synthProcessBlock straight into the writer's buffers. returns 0, or 1 if a write has failed
+int synthWavRender(SynthWavWriter_t *writer, Synth_t *synth, size_t n);
+
+//samples written so far
+uint64_t synthWavSamples(SynthWavWriter_t *writer);
+
+//write out what's left, finish the header and close. returns 0 if everything was written
+int synthWavClose(SynthWavWriter_t *writer);
+
+#endif // __SYNTH_WAV_H
@@ -0,0 +1,77 @@
+//host only: wavetable bank files, see synth_wavetable.h
+
+#include "synth_wavetable.h"
+#include "stdio.h"
+#include "string.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define SYNTH_WAVETABLE_NATIVE 0 //samples would need swapping, so they can't be used in place
+#else
+#define SYNTH_WAVETABLE_NATIVE 1
+#endif
+
+static size_t synthWavetableBytes(const SynthWavetable_t *table) {
+    return SYNTH_WAVETABLE_HEADER_SIZE + ((size_t) table->frameCount << table->bits) * sizeof(q15_t);
+}
+
+int synthWavetableLoad(SynthWavetable_t *table, const char *filename) {
+    if (!SYNTH_WAVETABLE_NATIVE) {
+        return 1;
+    }
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return 1;
+    }
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= SYNTH_WAVETABLE_HEADER_SIZE) {
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    //the mapping stays valid without the file descriptor
+    close(fd);
+    if (map == MAP_FAILED) {
+        return 1;
+    }
+    const uint8_t *header = map;
+    SynthWavetable_t bank = {
+        .samples = (const q15_t *) (header + SYNTH_WAVETABLE_HEADER_SIZE),
+        .frameCount = header[6] | header[7] << 8,
+        .bits = header[4],
+    };
+    if (memcmp(header, "SYWT", 4) || header[5] || bank.bits > 15 || bank.frameCount == 0
+            || synthWavetableBytes(&bank) != (size_t) st.st_size) {
+        munmap(map, st.st_size);
+        return 1;
+    }
+    *table = bank;
+    return 0;
+}
+
+void synthWavetableUnload(SynthWavetable_t *table) {
+    if (table->samples) {
+        munmap((void *) ((const uint8_t *) table->samples - SYNTH_WAVETABLE_HEADER_SIZE), synthWavetableBytes(table));
+        table->samples = NULL;
+        table->frameCount = 0;
+    }
+}
+
+int synthWavetableSave(const SynthWavetable_t *table, const char *filename) {
+    FILE *file = fopen(filename, "wb");
+    if (!file) {
+        return 1;
+    }
+    uint8_t header[SYNTH_WAVETABLE_HEADER_SIZE] = {'S', 'Y', 'W', 'T', table->bits, 0, table->frameCount, table->frameCount >> 8};
+    int res = fwrite(header, 1, sizeof(header), file) != sizeof(header);
+    size_t count = (size_t) table->frameCount << table->bits;
+    for (size_t i = 0; i < count && !res; i++) {
+        uint16_t sample = table->samples[i];
+        uint8_t bytes[2] = {sample, sample >> 8};
+        res = fwrite(bytes, 1, 2, file) != 2;
+    }
+    res |= fclose(file) != 0;
+    return res;
+}
@@ -0,0 +1,23 @@
+//host only: wavetable bank files, mapped into memory instead of being read into buffers.
+//the pages are shared by every voice playing the bank (and every process that maps the same file),
+//and only the frames that get played are ever loaded from disk
+#ifndef __SYNTH_WAVETABLE_H
+#define __SYNTH_WAVETABLE_H
+
+#include "synth.h"
+
+//bank file layout, all little endian:
+//  "SYWT", then a byte for bits, a zero byte, and a 16 bit frame count
+//  frameCount << bits 16 bit samples
+#define SYNTH_WAVETABLE_HEADER_SIZE 8
+
+//map a bank file and point table at it. returns 0, or 1 if it can't be opened or isn't a valid bank
+int synthWavetableLoad(SynthWavetable_t *table, const char *filename);
+
+//unmap a bank loaded with synthWavetableLoad. nodes playing it must not run after this
+void synthWavetableUnload(SynthWavetable_t *table);
+
+//write a bank to a file, e.g. one worked out at startup or converted from something else. returns 0 if it was written
+int synthWavetableSave(const SynthWavetable_t *table, const char *filename);
+
+#endif // __SYNTH_WAVETABLE_H
@@ -1,19 +1,23 @@
 
 #include "synth.h"
+#include "synth_wav.h"
+#include "synth_events.h"
 #include "stdio.h"
-#include "stdlib.h"
 
 q15_t half = Q15_MAX / 2;
-q15_t lfoPhaseInc = SYNTH_HZ_TO_PHASE(5);
+SynthPhase_t lfoPhaseInc = SYNTH_HZ_TO_INCREMENT(5);
 q15_t vibratoInc = SYNTH_HZ_TO_PHASE(10);
 
-int writeWav(char * filename, int16_t *audioBuffer, uint32_t sampleCount);
+//all the memory the synth uses: 2 voices with 7 nodes between them
+static uint8_t arena[SYNTH_ARENA_SIZE(2, 7)];
+static Synth_t synth;
 
 int main() {
+    synthInit(&synth, arena, sizeof(arena), 2);
 
     //wire up an oscillator to an envelope. envelope controls gain and detune
     //convention: the first node in a chain is the output node
-    SynthVoice_t *voice = &synthVoices[0];
+    SynthVoice_t *voice = synthVoiceAlloc(&synth, 0, 4);
     synthInitEnvelopeNode(&voice->nodes[1],
         NULL, //gain
         500, //attack
@@ -42,7 +46,7 @@ int main() {
     );
 
 
-    voice = &synthVoices[1];
+    voice = synthVoiceAlloc(&synth, 1, 3);
     synthInitEnvelopeNode(&voice->nodes[1],
         NULL, //gain
         100, //attack
@@ -63,9 +67,12 @@ int main() {
         4000 //factor
     );
 
-    //fill up a buffer with audio
-    int16_t *audioBuffer = malloc(SAMPLE_RATE * 60); //60 seconds
-    uint32_t sampleCount = 0;
+    //stream the audio to a wav file
+    SynthWavWriter_t *wav = synthWavOpen("output.wav", SYNTH_WAV_FILE);
+    if (!wav) {
+        printf("Failed to open output file\n");
+        return 1;
+    }
 
 
     //twinkle twinkle little star in midi notes. use note 0 to indicate rest
@@ -81,67 +88,29 @@ int main() {
         4, 4, 4, 4, 4, 4, 2, 2, 4, 4, 4, 4, 4, 4, 2, 2
     };
 
-    uint32_t noteDuration = 0;
-    uint32_t noteIndex = 0;
-    for (;;) {
-        if (noteDuration == 0) {
-            noteDuration = SYNTH_MS(2000/twinkleTwinkleBeats[noteIndex]);
-            uint8_t note = twinkleTwinkle[noteIndex];
-            if (note) {
-                synthVoiceNoteOn(&synthVoices[0], note);
-                synthVoiceNoteOn(&synthVoices[1], note - 24);
-            }
-            noteIndex++;
-            if (noteIndex >= sizeof(twinkleTwinkle)) {
-                break;
-            }
-        } else if (noteDuration < 500) {
-            //cut the note short slightly to allow decay
-            synthVoiceNoteOff(&synthVoices[0]);
-            synthVoiceNoteOff(&synthVoices[1]);
+    //queue up each note's events with the sample they happen on, then render up to the next note
+    static SynthEventQueue_t events;
+    synthEventInit(&events);
+    uint32_t time = 0;
+    for (uint32_t noteIndex = 0; noteIndex + 1 < sizeof(twinkleTwinkle); noteIndex++) {
+        uint32_t noteDuration = SYNTH_MS(2000/twinkleTwinkleBeats[noteIndex]);
+        uint8_t note = twinkleTwinkle[noteIndex];
+        if (note) {
+            synthEventNoteOn(&events, time, &synth.voices[0], note);
+            synthEventNoteOn(&events, time, &synth.voices[1], note - 24);
+        }
+        //cut the note short slightly to allow decay
+        synthEventNoteOff(&events, time + noteDuration - 499, &synth.voices[0]);
+        synthEventNoteOff(&events, time + noteDuration - 499, &synth.voices[1]);
+        time += noteDuration;
+        while (synthEventTime(&events) != time) {
+            synthWavRender(wav, &synth, synthEventDispatch(&events, time - synthEventTime(&events)));
         }
-        noteDuration--;
-
-        q15_t v = synthProcess();
-        audioBuffer[sampleCount++] = v;
     }
 
-    //write the audio buffer to a wav file
-    int res = writeWav("output.wav", audioBuffer, sampleCount);
-    free(audioBuffer);
+    int res = synthWavClose(wav);
+    if (res) {
+        printf("Failed to write output file\n");
+    }
     return res;
 }
-
-int writeWav(char * filename, int16_t *audioBuffer, uint32_t sampleCount) {
-    FILE *f = fopen(filename, "wb");
-    if (!f) {
-        printf("Failed to open output file\n");
-        return 1;
-    }
-    uint32_t sampleRate = SAMPLE_RATE;
-    //write the wav header
-    uint32_t fileSize = sampleCount * 2 + 36;
-    uint32_t byteRate = SAMPLE_RATE * 2;
-    uint32_t blockAlign = 2;
-    uint32_t bitsPerSample = 16;
-    uint32_t dataSize = sampleCount * 2;
-    fwrite("RIFF", 1, 4, f);
-    fwrite(&fileSize, 4, 1, f);
-    fwrite("WAVE", 1, 4, f);
-    fwrite("fmt ", 1, 4, f);
-    uint32_t fmtSize = 16;
-    fwrite(&fmtSize, 4, 1, f);
-    uint16_t format = 1;
-    fwrite(&format, 2, 1, f);
-    uint16_t channels = 1;
-    fwrite(&channels, 2, 1, f);
-    fwrite(&sampleRate, 4, 1, f);
-    fwrite(&byteRate, 4, 1, f);
-    fwrite(&blockAlign, 2, 1, f);
-    fwrite(&bitsPerSample, 2, 1, f);
-    fwrite("data", 1, 4, f);
-    fwrite(&dataSize, 4, 1, f);
-    fwrite(audioBuffer, 2, sampleCount, f);
-    fclose(f);
-    return 0;
-}
\ No newline at end of file